@@ -1,8 +1,11 @@
 #!/usr/bin/env python3
 """
 PNG to RGB565 Binary Converter for TFT_eSPI Sprites
-Converts PNG images to raw 16-bit RGB565 binary format
+Converts PNG images to 16-bit RGB565 frames in the panel's byte order, each behind
+a header giving its version, size, pixel format and byte order
 Supports sprite sheets organized by rows
+Packs every frame of several sheets into one atlas file (--atlas)
+or into a C++ header of constexpr arrays compiled into the firmware (--header)
 """
 
 import sys
@@ -27,10 +30,35 @@ def hex_to_rgb(hex_color):
     hex_color = hex_color.lstrip('#')
     return tuple(int(hex_color[i:i+2], 16) for i in (0, 2, 4))
 
+def resolve_transparent_color(transparent_color):
+    """Default to sky blue, accept hex strings or RGB tuples"""
+    if transparent_color is None:
+        return (48, 144, 160)  # #3090A0
+    if isinstance(transparent_color, str):
+        return hex_to_rgb(transparent_color)
+    return transparent_color
+
+def frame_to_rgb565(frame, transparent_color):
+    """Encode an RGBA frame as big-endian RGB565 pixels, row by row"""
+    width, height = frame.size
+    data = bytearray()
+    for y in range(height):
+        for x in range(width):
+            r, g, b, a = frame.getpixel((x, y))
+
+            # Handle transparency - replace with transparent color
+            if a < 128:  # Semi-transparent or fully transparent
+                r, g, b = transparent_color
+
+            # Write as big-endian 16-bit value
+            data += struct.pack('>H', rgb888_to_rgb565(r, g, b))
+    return bytes(data)
+
 def convert_png_to_bin(input_png, output_base, rows=1, transparent_color=None):
     """
     Convert PNG to RGB565 binary format.
     Supports sprite sheets organized by rows.
+    Each .bin file is a one-frame atlas (see below), so the game can check it before use.
 
     Args:
         input_png: Input PNG file path
@@ -61,16 +89,15 @@ def convert_png_to_bin(input_png, output_base, rows=1, transparent_color=None):
 
         print(f"Sprite sheet with {rows} row(s), each frame: {frame_width}x{frame_height}")
 
-        # Default transparent color to sky blue
-        if transparent_color is None:
-            transparent_color = (48, 144, 160)  # #3090A0
-        elif isinstance(transparent_color, str):
-            transparent_color = hex_to_rgb(transparent_color)
+        transparent_color = resolve_transparent_color(transparent_color)
 
         print(f"Transparent color: RGB{transparent_color}")
         rgb565_preview = rgb888_to_rgb565(*transparent_color)
         print(f"RGB565 value: 0x{rgb565_preview:04X}")
 
+        # Frames are named after the output file, as atlas frames are after their sheet
+        base = output_base.replace('\\', '/').rsplit('/', 1)[-1][:ATLAS_NAME_LENGTH - 3]
+
         # Process each row as a separate frame
         for frame_idx in range(rows):
             output_bin = f"{output_base}{frame_idx}.bin"
@@ -82,22 +109,10 @@ def convert_png_to_bin(input_png, output_base, rows=1, transparent_color=None):
             frame = img.crop(frame_region)
 
             # Convert to binary RGB565 format
-            with open(output_bin, 'wb') as f:
-                for y in range(frame_height):
-                    for x in range(frame_width):
-                        r, g, b, a = frame.getpixel((x, y))
-
-                        # Handle transparency - replace with transparent color
-                        if a < 128:  # Semi-transparent or fully transparent
-                            r, g, b = transparent_color
-
-                        # Convert to RGB565
-                        rgb565 = rgb888_to_rgb565(r, g, b)
+            name = f"{base}{frame_idx}"
+            size = write_atlas(output_bin, [name], [frame], [0], [encode_frame(frame, transparent_color, 'rgb565')])
 
-                        # Write as big-endian 16-bit value
-                        f.write(struct.pack('>H', rgb565))
-
-            print(f"Converted frame {frame_idx} to {output_bin} ({frame_width * frame_height * 2} bytes)")
+            print(f"Converted frame {frame_idx} to {output_bin} ({size} bytes)")
 
         if rows == 1:
             print(f"Successfully converted {input_png} to {output_base}0.bin")
@@ -111,6 +126,300 @@ def convert_png_to_bin(input_png, output_base, rows=1, transparent_color=None):
         print(f"Error: {e}")
         sys.exit(1)
 
+# Atlas layout (little-endian header, see lib/SpriteAtlas/SpriteAtlas.h):
+#   header: magic "SPAT", u16 version, u16 entry count, u32 atlas size in bytes,
+#           u8 byte order (1 = pixels and palettes big-endian, the panel's order),
+#           u8 entry size (36), 2 bytes padding
+#   entry:  char name[16] (NUL terminated), u32 data offset, u32 mask offset (0 = none),
+#           u16 w, h, u16 palette colors, u16 duration in ms (0 = the game's default),
+#           u8 format, 3 bytes padding
+#   data:   per frame, at its offset (2-byte aligned):
+#           RGB565:   w * h pixels, big-endian (the panel's byte order), row by row
+#           INDEXED4: colors big-endian RGB565 palette entries, then rows of (w + 1) / 2 bytes,
+#                     left pixel in the high nibble
+#           INDEXED8: colors palette entries, then rows of w bytes
+#           RLE:      colors palette entries (entry 0 is the background), h u16 row offsets into
+#                     the runs, then per row: runs of u8 skip, u8 count, count u8 indices,
+#                     ending with a run of count 0
+#   mask:   frames up to 32 pixels wide, after their data (4-byte aligned): h u32 rows with
+#           bit 31 - x set where pixel x is opaque, for pixel-exact collisions
+ATLAS_MAGIC = b'SPAT'
+ATLAS_VERSION = 5
+ATLAS_ORDER_PANEL = 1
+ATLAS_HEADER_SIZE = 16
+ATLAS_ENTRY_SIZE = 36
+MASK_MAX_WIDTH = 32
+ATLAS_NAME_LENGTH = 16
+ATLAS_FORMAT_RGB565 = 0
+ATLAS_FORMAT_INDEXED4 = 1
+ATLAS_FORMAT_INDEXED8 = 2
+ATLAS_FORMAT_RLE = 3
+FORMAT_NAMES = {'rgb565': ATLAS_FORMAT_RGB565, 'indexed4': ATLAS_FORMAT_INDEXED4, 'indexed8': ATLAS_FORMAT_INDEXED8,
+                'rle': ATLAS_FORMAT_RLE}
+
+def encode_rle(frame, transparent_color):
+    """
+    Encode the opaque pixels of a frame (alpha >= 128) as runs of palette indices.
+    Returns (palette, row offsets, runs); palette entry 0 is the transparent colour,
+    which the firmware paints where it cannot skip pixels.
+    """
+    background = struct.pack('>H', rgb888_to_rgb565(*transparent_color))
+    palette = [background]
+    index = {background: 0}
+    width, height = frame.size
+    if width > 255:
+        raise ValueError(f"rle frames are at most 255 pixels wide, not {width}")
+    offsets = []
+    runs = bytearray()
+    for y in range(height):
+        offsets.append(len(runs))
+        x = 0
+        while x < width:
+            skip = 0
+            while x < width and frame.getpixel((x, y))[3] < 128:
+                x += 1
+                skip += 1
+            run = []
+            while x < width and frame.getpixel((x, y))[3] >= 128:
+                r, g, b, _ = frame.getpixel((x, y))
+                color = struct.pack('>H', rgb888_to_rgb565(r, g, b))
+                if color not in index:
+                    index[color] = len(palette)
+                    palette.append(color)
+                run.append(index[color])
+                x += 1
+            if run:
+                runs += bytes([skip, len(run)] + run)
+        runs += bytes([0, 0])
+    if len(runs) > 0xFFFF:
+        raise ValueError("frame too large for rle")
+    return palette, offsets, bytes(runs)
+
+def collision_mask(frame):
+    """
+    One u32 per row, bit 31 - x set where pixel x is opaque (alpha >= 128), or None for
+    frames wider than a word. Shifting a row right by dx moves it dx pixels right.
+    """
+    width, height = frame.size
+    if width > MASK_MAX_WIDTH:
+        return None
+    return [sum(1 << (31 - x) for x in range(width) if frame.getpixel((x, y))[3] >= 128) for y in range(height)]
+
+def encode_frame(frame, transparent_color, format_name='auto'):
+    """
+    Encode a frame in the requested format. With 'auto', frames with transparent
+    pixels become RLE so they can be drawn over other sprites; opaque frames take the
+    smallest format that holds their colours: 4 bits per pixel up to 16 colours, 8 up
+    to 256, RGB565 beyond.
+    Returns (format, palette, pixels): palette is a list of big-endian RGB565 byte
+    pairs (empty for RGB565), pixels the encoded rows (row offsets then runs for RLE).
+    """
+    transparent = any(frame.getpixel((x, y))[3] < 128 for y in range(frame.size[1]) for x in range(frame.size[0]))
+    if format_name == 'rle' or (format_name == 'auto' and transparent):
+        palette, offsets, runs = encode_rle(frame, transparent_color)
+        if len(palette) <= 256:
+            return ATLAS_FORMAT_RLE, palette, struct.pack(f'<{len(offsets)}H', *offsets) + runs
+        if format_name == 'rle':
+            raise ValueError(f"{len(palette)} colours do not fit rle (256 at most)")
+
+    data = frame_to_rgb565(frame, transparent_color)
+    colors = [data[i:i + 2] for i in range(0, len(data), 2)]
+    palette = sorted(set(colors))
+    if format_name == 'auto':
+        fmt = ATLAS_FORMAT_INDEXED4 if len(palette) <= 16 else ATLAS_FORMAT_INDEXED8 if len(palette) <= 256 else ATLAS_FORMAT_RGB565
+    else:
+        fmt = FORMAT_NAMES[format_name]
+        limit = {ATLAS_FORMAT_INDEXED4: 16, ATLAS_FORMAT_INDEXED8: 256}.get(fmt)
+        if limit is not None and len(palette) > limit:
+            raise ValueError(f"{len(palette)} colours do not fit {format_name} ({limit} at most)")
+    if fmt == ATLAS_FORMAT_RGB565:
+        return fmt, [], data
+
+    index = {color: i for i, color in enumerate(palette)}
+    width, height = frame.size
+    pixels = bytearray()
+    for y in range(height):
+        row = [index[color] for color in colors[y * width:(y + 1) * width]]
+        if fmt == ATLAS_FORMAT_INDEXED8:
+            pixels += bytes(row)
+        else:
+            row.append(0)  # Pads odd widths to a whole byte
+            pixels += bytes(row[x] << 4 | row[x + 1] for x in range(0, width, 2))
+    return fmt, palette, bytes(pixels)
+
+def load_sheet_frames(sheets):
+    """
+    Split "file.png[:rows][@ms[,ms...]]" sheets into frames named <file>0, <file>1, ...
+    like the per-frame .bin files. The frames of a sheet make up an animation clip;
+    @ms sets how long each one shows (one value for all, or one per frame).
+    Returns (names, frames, durations), durations 0 where the game's default applies.
+    """
+    names = []
+    frames = []
+    durations = []
+    for sheet in sheets:
+        sheet, _, timing = sheet.partition('@')
+        path, _, rows = sheet.partition(':')
+        rows = int(rows) if rows else 1
+        timing = [int(ms) for ms in timing.split(',')] if timing else [0]
+        if len(timing) == 1:
+            timing *= rows
+        if len(timing) != rows or not all(0 <= ms <= 0xFFFF for ms in timing):
+            raise ValueError(f"'{sheet}' needs one duration for all {rows} frames or one each, in ms up to 65535")
+        img = Image.open(path).convert('RGBA')
+        width, height = img.size
+        frame_height = height // rows
+        base = path.replace('\\', '/').rsplit('/', 1)[-1].rsplit('.', 1)[0]
+        for frame_idx in range(rows):
+            name = f"{base}{frame_idx}"
+            if len(name) >= ATLAS_NAME_LENGTH:
+                raise ValueError(f"sprite name '{name}' is longer than {ATLAS_NAME_LENGTH - 1} characters")
+            names.append(name)
+            frames.append(img.crop((0, frame_idx * frame_height, width, (frame_idx + 1) * frame_height)))
+        durations += timing
+    return names, frames, durations
+
+def write_atlas(output, names, frames, durations, encoded):
+    """
+    Write encoded frames (as returned by encode_frame) as an atlas file.
+    Returns its size in bytes.
+    """
+    offset = ATLAS_HEADER_SIZE + ATLAS_ENTRY_SIZE * len(frames)
+    blobs = []
+    entries = []
+    for name, frame, duration, (fmt, palette, pixels) in zip(names, frames, durations, encoded):
+        blob = b''.join(palette) + pixels
+        blob += b'\0' * (-len(blob) % 4)  # Keeps the mask 4-byte aligned, the next frame too
+        mask = collision_mask(frame)
+        mask_offset = 0
+        if mask is not None:
+            mask_offset = offset + len(blob)
+            blob += struct.pack(f'<{len(mask)}I', *mask)
+        entries.append(name.encode('ascii').ljust(ATLAS_NAME_LENGTH, b'\0') +
+                       struct.pack('<IIHHHHB3x', offset, mask_offset, frame.size[0], frame.size[1], len(palette),
+                                   duration, fmt))
+        blobs.append(blob)
+        offset += len(blob)
+
+    with open(output, 'wb') as f:
+        f.write(ATLAS_MAGIC)
+        f.write(struct.pack('<HHIBBxx', ATLAS_VERSION, len(frames), offset, ATLAS_ORDER_PANEL, ATLAS_ENTRY_SIZE))
+        f.write(b''.join(entries))
+        f.write(b''.join(blobs))
+    return offset
+
+def build_atlas(sheets, output, format_name='auto', transparent_color=None):
+    """
+    Store every frame of the given sheets in one atlas file.
+
+    Args:
+        sheets: List of "file.png[:rows][@ms]"; frames are named <file>0, <file>1, ...
+                like the per-frame .bin files, and shown for ms each when animated
+        output: Atlas file path (e.g. "data/sprites.atlas")
+        format_name: 'auto' (smallest per frame), 'rgb565', 'indexed4' or 'indexed8'
+        transparent_color: Background for transparent pixels, as in convert_png_to_bin
+    """
+    transparent_color = resolve_transparent_color(transparent_color)
+    names, frames, durations = load_sheet_frames(sheets)
+    encoded = [encode_frame(frame, transparent_color, format_name) for frame in frames]
+    size = write_atlas(output, names, frames, durations, encoded)
+
+    names_by_format = {v: k for k, v in FORMAT_NAMES.items()}
+    raw = sum(frame.size[0] * frame.size[1] * 2 for frame in frames)
+    stored = [len(palette) * 2 + len(pixels) for _, palette, pixels in encoded]
+    print(f"Stored {len(frames)} frames in {output}: {size} bytes ({sum(stored)} of pixel data, {raw} as RGB565)")
+    for name, frame, duration, (fmt, palette, pixels), length in zip(names, frames, durations, encoded, stored):
+        print(f"  {name:<{ATLAS_NAME_LENGTH}} {frame.size[0]:3}x{frame.size[1]:<3} "
+              f"{names_by_format[fmt]:<8} {len(palette):3} colours {length:5} bytes"
+              + (f" {duration} ms" if duration else ""))
+
+def build_header(sheets, output, format_name='auto', transparent_color=None):
+    """
+    Write every frame of the given sheets as constexpr arrays in a C++ header, so the
+    firmware can blit them straight from flash with no loading at boot.
+
+    Args:
+        sheets: List of "file.png[:rows][@ms]", as for build_atlas
+        output: Header path (e.g. "embedded_sprites.h")
+        format_name: Pixel format per frame, as for build_atlas
+        transparent_color: Background for transparent pixels, as in convert_png_to_bin
+    """
+    transparent_color = resolve_transparent_color(transparent_color)
+    names, frames, durations = load_sheet_frames(sheets)
+    encoded = [encode_frame(frame, transparent_color, format_name) for frame in frames]
+
+    def words(data):
+        # Keep the panel's byte order in memory: each big-endian pair read as a little-endian word
+        return [f"0x{data[i + 1] << 8 | data[i]:04X}" for i in range(0, len(data), 2)]
+
+    def array(kind, name, values):
+        lines.append(f"constexpr {kind} {name}[] PROGMEM = {{")
+        for i in range(0, len(values), 12):
+            lines.append("    " + ", ".join(values[i:i + 12]) + ",")
+        lines.append("};")
+
+    lines = [
+        f"// Generated by convert_sprite.py --header from {', '.join(sheets)}. Do not edit.",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        f"#define EMBEDDED_SPRITES_VERSION {ATLAS_VERSION} // ATLAS_VERSION of the converter that wrote this",
+        "",
+        "#ifndef PROGMEM",
+        "#define PROGMEM",
+        "#endif",
+        "",
+        "struct EmbeddedSprite",
+        "{",
+        "  const char *name;",
+        "  uint16_t width;",
+        "  uint16_t height;",
+        "  uint8_t format;          // ATLAS_FORMAT_* (SpriteAtlas.h)",
+        "  const uint16_t *pixels;  // RGB565 in the panel's byte order, width * height",
+        "  const uint8_t *indices;  // Indexed formats: palette indices, rows packed as in the atlas",
+        "  const uint16_t *palette; // Indexed formats: colours in the panel's byte order",
+        "  uint16_t colors;",
+        "  const uint16_t *rows;    // RLE: offset of each row's runs in indices",
+        "  uint16_t duration;       // ms shown when animated, 0 = the game's default",
+        "  const uint32_t *mask;    // Collision mask: a word per row, leftmost pixel in bit 31; nullptr if none",
+        "};",
+        "",
+    ]
+    for name, frame, (fmt, palette, pixels) in zip(names, frames, encoded):
+        if fmt == ATLAS_FORMAT_RGB565:
+            array("uint16_t", f"{name}Pixels", words(pixels))
+        elif fmt == ATLAS_FORMAT_RLE:
+            height = frame.size[1]
+            offsets = struct.unpack_from(f'<{height}H', pixels)
+            array("uint16_t", f"{name}Palette", words(b''.join(palette)))
+            array("uint16_t", f"{name}Rows", [str(offset) for offset in offsets])
+            array("uint8_t", f"{name}Indices", [f"0x{b:02X}" for b in pixels[2 * height:]])
+        else:
+            array("uint16_t", f"{name}Palette", words(b''.join(palette)))
+            array("uint8_t", f"{name}Indices", [f"0x{b:02X}" for b in pixels])
+        mask = collision_mask(frame)
+        if mask is not None:
+            array("uint32_t", f"{name}Mask", [f"0x{row:08X}" for row in mask])
+        lines.append("")
+    lines.append("constexpr EmbeddedSprite embeddedSprites[] = {")
+    for name, frame, duration, (fmt, palette, pixels) in zip(names, frames, durations, encoded):
+        if fmt == ATLAS_FORMAT_RGB565:
+            data = f"{name}Pixels, nullptr, nullptr, 0, nullptr"
+        elif fmt == ATLAS_FORMAT_RLE:
+            data = f"nullptr, {name}Indices, {name}Palette, {len(palette)}, {name}Rows"
+        else:
+            data = f"nullptr, {name}Indices, {name}Palette, {len(palette)}, nullptr"
+        mask = f"{name}Mask" if collision_mask(frame) is not None else "nullptr"
+        lines.append(f'    {{"{name}", {frame.size[0]}, {frame.size[1]}, {fmt}, {data}, {duration}, {mask}}},')
+    lines.append("};")
+    lines.append(f"#define EMBEDDED_SPRITE_COUNT {len(frames)}")
+
+    with open(output, 'w') as f:
+        f.write("\n".join(lines) + "\n")
+    print(f"Wrote {len(frames)} frames to {output} "
+          f"({sum(len(palette) * 2 + len(pixels) for _, palette, pixels in encoded)} bytes of pixels and palettes)")
+
 def main():
     parser = argparse.ArgumentParser(
         description='Convert PNG sprite sheets to RGB565 binary format for TFT_eSPI',
@@ -120,25 +429,47 @@ def main():
   python convert_sprite.py sleigh.png --rows 2
   python convert_sprite.py sleigh.png --rows 2 --bg #3090A0
   python convert_sprite.py duck.png --rows 2 --output data/duck
+  python convert_sprite.py --atlas data/sprites.atlas sleigh.png:2 duck.png:2@500 foe.png:2@500 gift.png explosion.png:2 --bg '#3850F8'
+  python convert_sprite.py --header embedded_sprites.h sleigh.png:2 duck.png:2@500 foe.png:2@500 gift.png explosion.png:2 --bg '#3850F8'
         '''
     )
 
-    parser.add_argument('input', help='Input PNG file path')
+    parser.add_argument('input', nargs='+',
+                        help='Input PNG file path (with --atlas or --header: one or more file.png[:rows][@ms] sheets)')
     parser.add_argument('-r', '--rows', type=int, default=1,
                         help='Number of rows in sprite sheet (default: 1)')
     parser.add_argument('-o', '--output', help='Output base path (default: data/<filename>)')
     parser.add_argument('-bg', '--background', '--bg', dest='background',
                         help='Background color for transparency as hex (e.g., #3090A0)')
+    parser.add_argument('--atlas', help='Pack every frame of the inputs into this atlas file')
+    parser.add_argument('--header', help='Write every frame of the inputs as constexpr arrays to this C++ header')
+    parser.add_argument('--format', choices=['auto'] + list(FORMAT_NAMES), default='auto',
+                        help='Atlas/header pixel format (default: auto, the smallest that holds each frame\'s colours)')
 
     args = parser.parse_args()
 
+    if args.atlas or args.header:
+        try:
+            if args.atlas:
+                build_atlas(args.input, args.atlas, args.format, args.background)
+            if args.header:
+                build_header(args.input, args.header, args.format, args.background)
+        except (OSError, ValueError) as e:
+            print(f"Error: {e}")
+            sys.exit(1)
+        return
+
+    if len(args.input) != 1:
+        parser.error('converting to .bin takes a single input (use --atlas to pack several)')
+    input_png = args.input[0]
+
     # Determine output base path
     if args.output:
         output_base = args.output
     else:
-        output_base = "data/" + args.input.rsplit('.', 1)[0]
+        output_base = "data/" + input_png.rsplit('.', 1)[0]
 
-    convert_png_to_bin(args.input, output_base, rows=args.rows, transparent_color=args.background)
+    convert_png_to_bin(input_png, output_base, rows=args.rows, transparent_color=args.background)
 
 if __name__ == "__main__":
     main()
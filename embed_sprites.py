@@ -0,0 +1,38 @@
+"""
+PlatformIO pre-build step of the esp32dev_embedded env: embed the sprite sheets in the firmware.
+
+Runs convert_sprite.py --header over the PNGs in the project root and writes
+$BUILD_DIR/generated/embedded_sprites.h, which the firmware includes when
+SPRITE_SOURCE is SPRITES_EMBEDDED. The header is only regenerated when a sheet
+or the converter is newer than it. Pillow must already be installed for the
+project's Python; the build stops with a message rather than installing it.
+"""
+
+import os
+import subprocess
+import sys
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+SHEETS = ["sleigh.png:2", "duck.png:2@500", "foe.png:2@500", "gift.png", "explosion.png:2"]
+BACKGROUND = "#3850F8"  # Sky blue, for transparent pixels
+
+project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+out_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")  # noqa: F821
+header = os.path.join(out_dir, "embedded_sprites.h")
+converter = os.path.join(project_dir, "convert_sprite.py")
+python = env.subst("$PYTHONEXE")  # noqa: F821
+
+inputs = [converter] + [os.path.join(project_dir, sheet.split("@")[0].split(":")[0]) for sheet in SHEETS]
+stale = not os.path.exists(header) or any(os.path.getmtime(path) > os.path.getmtime(header) for path in inputs)
+
+if stale:
+    os.makedirs(out_dir, exist_ok=True)
+    if subprocess.call([python, "-c", "import PIL"], stderr=subprocess.DEVNULL) != 0:
+        sys.stderr.write(f'embed_sprites.py: Pillow is missing; install it with "{python}" -m pip install pillow\n')
+        env.Exit(1)  # noqa: F821
+    command = [python, converter, "--header", header] + SHEETS + ["--bg", BACKGROUND]
+    if subprocess.call(command, cwd=project_dir) != 0:
+        env.Exit(1)  # noqa: F821
+
+env.Append(CPPPATH=[out_dir])  # noqa: F821
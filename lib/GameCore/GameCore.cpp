@@ -0,0 +1,760 @@
+#include "GameCore.h"
+
+// ============================================================================
+// RANDOMNESS & TIMING
+// ============================================================================
+
+void seedGame(GameData &game, uint32_t seed)
+{
+  game.rngState = seed != 0 ? seed : 0x9E3779B9; // xorshift never leaves zero
+}
+
+// xorshift32: fast, and identical on every platform for a given seed
+uint32_t gameRandom(GameData &game, uint32_t min, uint32_t max)
+{
+  uint32_t s = game.rngState;
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  game.rngState = s;
+  return max > min ? min + s % (max - min) : min;
+}
+
+// Pixels per step, sub-pixel precise (cheat mode speeds up by 1/20 px per point)
+static fixed_t obstacleSpeed(const GameData &game)
+{
+  switch (game.gameMode)
+  {
+  case MODE_SPEED:
+    return TO_FIXED(8);
+  case MODE_CHEAT:
+    return TO_FIXED(8) + game.currentScore * (FIXED_ONE / 20);
+  default:
+    return TO_FIXED(2);
+  }
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+// A new flying obstacle at the right edge: 80% duck, 16% gift, 4% foe, playing its type's clip
+// from the first frame
+static void spawnFlying(GameData &game, int slot, int x)
+{
+  EntityStore &entities = game.entities;
+  entities.place(slot, x, gameRandom(game, 5, 40));
+  entities.fallVelocity[slot] = 0;
+  int randType = gameRandom(game, 0, 100);
+  if (randType < 80)
+  {
+    entities.type[slot] = TYPE_DUCK;
+  }
+  else if (randType < 96)
+  {
+    entities.type[slot] = TYPE_GIFT;
+  }
+  else
+  {
+    entities.type[slot] = TYPE_FOE;
+    // Foe spawns at middle height for easier combat
+    entities.y[slot] = entities.oldY[slot] = PLAYFIELD_HEIGHT / 2 - DUCK_HEIGHT / 2;
+  }
+  ClipId clip = entities.type[slot] == TYPE_FOE ? CLIP_FOE : entities.type[slot] == TYPE_GIFT ? CLIP_GIFT : CLIP_DUCK;
+  entities.anim[slot] = {(uint8_t)clip, 0, 0};
+}
+
+void initializeGameData(GameData &game)
+{
+  game.state = STATE_MENU;
+  game.lastStateChange = game.simTime;
+
+  game.sleighY = TO_FIXED(30);
+  game.sleighVelocity = 0;
+  game.sleighOldY = game.sleighY;
+  game.pendingFlap = -1;
+  game.sleighCrashed = false;
+  game.sleighExploding = false;
+  game.explosionStartTime = 0;
+
+  game.currentScore = 0;
+
+  game.highScoreUpdated = false;
+
+  // Initialize obstacles - spread them out at start, only the first 3 of each kind active
+  EntityStore &entities = game.entities;
+  entities.activeCount = 0;
+  entities.byXHead = 0;
+  entities.byXCount = 0;
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    entities.flags[slot] = 0;
+    entities.spawnTimer[slot] = 0;
+  }
+  for (int i = 0; i < TREE_COUNT; i++)
+  {
+    entities.place(i, SCREEN_WIDTH + (i * OBSTACLE_SPAWN_DISTANCE), PLAYFIELD_HEIGHT - TREE_HEIGHT);
+    entities.type[i] = TYPE_TREE;
+    entities.anim[i] = {};
+    entities.fallVelocity[i] = 0;
+    if (i < 3)
+    {
+      entities.activate(i);
+    }
+  }
+  for (int i = 0; i < DUCK_COUNT; i++)
+  {
+    spawnFlying(game, FIRST_FLYING_SLOT + i, SCREEN_WIDTH + (i * OBSTACLE_SPAWN_DISTANCE) + OBSTACLE_SPAWN_OFFSET);
+    if (i < 3)
+    {
+      entities.activate(FIRST_FLYING_SLOT + i);
+    }
+  }
+}
+
+void setClip(GameData &game, ClipId clip, const uint16_t *durations, int frameCount)
+{
+  AnimationClip &target = game.clips[clip];
+  target.frameCount = frameCount < MAX_CLIP_FRAMES ? frameCount : MAX_CLIP_FRAMES;
+  for (int i = 0; i < target.frameCount; i++)
+  {
+    target.durations[i] = durations[i];
+  }
+}
+
+// ============================================================================
+// INPUT HANDLING
+// ============================================================================
+
+void applyInput(GameData &game, const StepInput &input)
+{
+  bool action = input.button1 || input.button2;
+  switch (game.state)
+  {
+  case STATE_MENU:
+    if (input.button2)
+    {
+      game.gameMode = (GameMode)((game.gameMode + 1) % 3);
+    }
+    if (input.button1)
+    {
+      game.state = STATE_PLAYING;
+      game.lastStateChange = game.simTime;
+    }
+    break;
+  case STATE_PLAYING:
+    if (action && !game.sleighCrashed)
+    {
+      // Flap at the moment the button went down, not at the start of the step
+      game.pendingFlap = input.pressFraction;
+    }
+    else if (action && game.sleighCrashed && game.gameMode == MODE_CHEAT)
+    {
+      if (game.crashingStartTime + 300 < game.simTime)
+      {
+        game.sleighCrashed = false;
+        game.sleighVelocity = JUMP_STRENGTH / 2;
+      }
+    }
+    break;
+  case STATE_GAME_OVER:
+    if (action)
+    {
+      // Reset game
+      game.currentScore = 0;
+      initializeGameData(game);
+    }
+  }
+}
+
+// ============================================================================
+// PHYSICS & UPDATES
+// ============================================================================
+
+void updatePhysics(GameData &game)
+{
+  // Stop physics when exploding
+  if (game.sleighExploding)
+  {
+    return;
+  }
+
+  fixed_t currentGravity = GRAVITY;
+
+  // Double gravity when sleigh is crashed
+  if (game.sleighCrashed)
+  {
+    currentGravity *= 2;
+  }
+
+  game.sleighOldY = game.sleighY;
+
+  if (game.pendingFlap >= 0)
+  {
+    // Fall for the part of the step before the flap, then climb for the rest
+    fixed_t before = game.pendingFlap;
+    fixed_t after = FIXED_ONE - game.pendingFlap;
+    game.sleighVelocity += FIXED_MUL(currentGravity, before);
+    game.sleighY += FIXED_MUL(game.sleighVelocity, before);
+    game.sleighVelocity = JUMP_STRENGTH + FIXED_MUL(currentGravity, after);
+    game.sleighY += FIXED_MUL(game.sleighVelocity, after);
+    game.pendingFlap = -1;
+    return;
+  }
+
+  game.sleighVelocity += currentGravity;
+  game.sleighY += game.sleighVelocity;
+}
+
+// Move a cursor on by one step, through as many frames as the step covers.
+// A zero duration holds its frame.
+static void advanceClip(ClipCursor &cursor, const AnimationClip &clip)
+{
+  if (clip.frameCount < 2)
+  {
+    return;
+  }
+  cursor.elapsed += SIM_STEP_MS;
+  while (clip.durations[cursor.frame] != 0 && cursor.elapsed >= clip.durations[cursor.frame])
+  {
+    cursor.elapsed -= clip.durations[cursor.frame];
+    cursor.frame = cursor.frame + 1 < clip.frameCount ? cursor.frame + 1 : 0;
+  }
+}
+
+void updateFlyingAnimation(GameData &game)
+{
+  // Every flying obstacle's clip, in one pass
+  EntityStore &entities = game.entities;
+  for (int i = 0; i < entities.activeCount; i++)
+  {
+    int slot = entities.active[i];
+    if (entities.type[slot] != TYPE_TREE)
+    {
+      advanceClip(entities.anim[slot], game.clips[entities.anim[slot].clip]);
+    }
+  }
+
+  // Falling foes drop until they hit the ground
+  for (int i = 0; i < entities.activeCount;)
+  {
+    int slot = entities.active[i];
+    if (entities.flags[slot] & ENTITY_FALLING)
+    {
+      entities.fallVelocity[slot] += GRAVITY;
+      entities.move(slot, 0, entities.fallVelocity[slot]);
+      if (entities.y[slot] >= PLAYFIELD_HEIGHT)
+      {
+        entities.deactivate(slot);
+        entities.spawnTimer[slot] = game.simTime + gameRandom(game, SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
+        continue;
+      }
+    }
+    i++;
+  }
+}
+
+// Whether an obstacle of the given kind spawning at (newX, newY) would crowd one already in play:
+// trees keep 20 pixels apart, flying obstacles 30 across or 20 up and down. Only the right end
+// of byX can be that close to the spawn point.
+static bool overlapsOthers(const GameData &game, bool tree, int newX, int newY)
+{
+  const int X_MARGIN = tree ? 20 : 30; // Minimum horizontal distance between obstacles
+  const int Y_MARGIN = tree ? SCREEN_HEIGHT : 20; // Minimum vertical distance (trees all stand on the ground)
+
+  const EntityStore &entities = game.entities;
+  for (int i = entities.byXCount - 1; i >= 0; i--)
+  {
+    int slot = entities.ordered(i);
+    int xDistance = newX - entities.x[slot];
+    if (xDistance >= X_MARGIN)
+    {
+      break; // This one and all left of it are far enough away
+    }
+    if ((entities.type[slot] == TYPE_TREE) != tree)
+    {
+      continue; // Other kind
+    }
+
+    if (xDistance < 0)
+      xDistance = -xDistance;
+
+    int yDistance = newY - entities.y[slot];
+    if (yDistance < 0)
+      yDistance = -yDistance;
+
+    // If both distances are too small, there's an overlap
+    if (xDistance < X_MARGIN && yDistance < Y_MARGIN)
+    {
+      return true; // Overlap detected
+    }
+  }
+
+  return false; // No overlap
+}
+
+// Sprite width of an obstacle type
+static int obstacleWidth(uint8_t type)
+{
+  return type == TYPE_TREE ? TREE_WIDTH : DUCK_WIDTH;
+}
+
+void updateObstacles(GameData &game)
+{
+  uint32_t currentTime = game.simTime;
+  if (game.sleighExploding)
+  {
+    return;
+  }
+
+  // Scroll everything in play, then retire what went off-screen from the left end. One that is
+  // past its edge waits for any still on screen left of it, a step or two at most, and for
+  // checkCollisions to sweep this step's motion when it started level with the sleigh: at cheat
+  // mode speeds one step can carry an obstacle from in front of the sleigh to off-screen.
+  EntityStore &entities = game.entities;
+  fixed_t speed = obstacleSpeed(game);
+  for (int i = 0; i < entities.byXCount; i++)
+  {
+    entities.move(entities.ordered(i), -speed);
+  }
+  while (entities.byXCount > 0)
+  {
+    int slot = entities.ordered(0);
+    if (entities.x[slot] >= (entities.type[slot] == TYPE_TREE ? -TREE_WIDTH : -DUCK_WIDTH * 2) ||
+        entities.oldX[slot] + obstacleWidth(entities.type[slot]) > SLEIGH_START_X)
+    {
+      break;
+    }
+    // Start spawn delay timer
+    entities.deactivate(slot);
+    entities.spawnTimer[slot] = currentTime + gameRandom(game, SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
+  }
+
+  // Respawn slots whose delay is over at the right edge, unless that crowds one in play
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    if (entities.isActive(slot) || currentTime < entities.spawnTimer[slot])
+    {
+      continue;
+    }
+    bool tree = slot < FIRST_FLYING_SLOT;
+    if (tree)
+    {
+      entities.place(slot, SCREEN_WIDTH, PLAYFIELD_HEIGHT - TREE_HEIGHT);
+    }
+    else
+    {
+      spawnFlying(game, slot, SCREEN_WIDTH);
+    }
+    if (overlapsOthers(game, tree, entities.x[slot], entities.y[slot]))
+    {
+      // Overlap detected, reschedule spawn
+      entities.spawnTimer[slot] = currentTime + gameRandom(game, SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
+    }
+    else
+    {
+      entities.activate(slot);
+    }
+  }
+}
+
+void updateScore(GameData &game)
+{
+  // Don't score points if sleigh has crashed
+  if (game.sleighCrashed)
+  {
+    return;
+  }
+
+  // A point for each tree, duck and foe once it is behind the sleigh; gifts only count when collected.
+  // Those are the left end of byX, up to the first one still reaching the sleigh.
+  EntityStore &entities = game.entities;
+  for (int i = 0; i < entities.byXCount; i++)
+  {
+    int slot = entities.ordered(i);
+    if (entities.x[slot] + obstacleWidth(entities.type[slot]) >= SLEIGH_START_X)
+    {
+      break;
+    }
+    if (!(entities.flags[slot] & ENTITY_SCORED))
+    {
+      entities.flags[slot] |= ENTITY_SCORED;
+      if (entities.type[slot] != TYPE_GIFT)
+      {
+        game.currentScore++;
+      }
+    }
+  }
+}
+
+// ============================================================================
+// COLLISION DETECTION
+// ============================================================================
+
+// Whether two masked frames at screen (ax, ay) and (bx, by) share an opaque pixel: a box test,
+// then one shift and AND per overlapping row
+static bool masksOverlap(const CollisionMask &a, int ax, int ay, const CollisionMask &b, int bx, int by)
+{
+  int top = ay > by ? ay : by;
+  int bottom = ay + a.height < by + b.height ? ay + a.height : by + b.height;
+  if (ax >= bx + b.width || bx >= ax + a.width || top >= bottom)
+  {
+    return false;
+  }
+  int dx = bx - ax; // Within (-32, 32) once the boxes overlap
+  for (int y = top; y < bottom; y++)
+  {
+    uint32_t rowA = a.rows[y - ay];
+    uint32_t rowB = b.rows[y - by];
+    if (dx >= 0 ? rowA & (rowB >> dx) : (rowA >> -dx) & rowB)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A collision box in fixed_t pixels at the start of the step, and how far it moves by the end
+struct SweptBox
+{
+  fixed_t x;
+  fixed_t y;
+  fixed_t w;
+  fixed_t h;
+  fixed_t dx;
+  fixed_t dy;
+};
+
+// Narrow [enter, exit) (in SWEEP_ONE per step) to the times a's span [a, a + aSize) overlaps
+// b's span [b, b + bSize) along one axis, with a moving by motion relative to b
+static void sweepAxis(fixed_t a, fixed_t aSize, fixed_t b, fixed_t bSize, fixed_t motion, int &enter, int &exit)
+{
+  fixed_t low = b - aSize - a; // Overlap while a's offset is above low and below high
+  fixed_t high = b + bSize - a;
+  if (motion == 0)
+  {
+    if (low >= 0 || high <= 0)
+    {
+      exit = enter; // Never overlap
+    }
+    return;
+  }
+  int64_t from = (int64_t)low * SWEEP_ONE / motion;
+  int64_t to = (int64_t)high * SWEEP_ONE / motion;
+  if (motion < 0)
+  {
+    int64_t swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from > enter)
+    enter = from > SWEEP_ONE ? SWEEP_ONE : (int)from;
+  if (to < exit)
+    exit = to < 0 ? 0 : (int)to;
+}
+
+// When during the step two moving boxes first overlap, from 0 (start) to SWEEP_ONE (end),
+// or -1 if they never do. exit is when they part again.
+static int sweepBoxes(const SweptBox &a, const SweptBox &b, int &exit)
+{
+  int enter = 0;
+  exit = SWEEP_ONE;
+  sweepAxis(a.x, a.w, b.x, b.w, a.dx - b.dx, enter, exit);
+  sweepAxis(a.y, a.h, b.y, b.h, a.dy - b.dy, enter, exit);
+  return enter < exit ? enter : -1;
+}
+
+// Where a swept box is at step time t, in whole pixels
+static int sweptX(const SweptBox &box, int t)
+{
+  return FIXED_TO_INT(box.x + (fixed_t)((int64_t)box.dx * t / SWEEP_ONE));
+}
+
+static int sweptY(const SweptBox &box, int t)
+{
+  return FIXED_TO_INT(box.y + (fixed_t)((int64_t)box.dy * t / SWEEP_ONE));
+}
+
+// When during this step the sleigh first touches the obstacle in slot, or -1. Exact against
+// collision masks when both sides have one: the frames' boxes are swept, then the masks are
+// compared at every pixel of relative motion while the boxes overlap.
+// Otherwise the hand-tuned hitboxes (sleighBox, box) are swept.
+static int sleighImpact(const GameData &game, const CollisionMask *mask, int slot, const SweptBox &sleighBox,
+                        const SweptBox &box)
+{
+  const CollisionMask *sleigh = game.masks != nullptr ? &game.masks->sleigh[game.sleighVelocity < 0 ? 0 : 1] : nullptr;
+  int exit;
+  if (sleigh == nullptr || sleigh->rows == nullptr || mask == nullptr || mask->rows == nullptr)
+  {
+    return sweepBoxes(sleighBox, box, exit);
+  }
+
+  SweptBox a = {(fixed_t)SLEIGH_START_X * FIXED_ONE, game.sleighOldY, (fixed_t)sleigh->width * FIXED_ONE,
+                (fixed_t)sleigh->height * FIXED_ONE, 0, game.sleighY - game.sleighOldY};
+  const EntityStore &entities = game.entities;
+  SweptBox b = {(fixed_t)entities.oldX[slot] * FIXED_ONE, (fixed_t)entities.oldY[slot] * FIXED_ONE,
+                (fixed_t)mask->width * FIXED_ONE, (fixed_t)mask->height * FIXED_ONE,
+                (fixed_t)(entities.x[slot] - entities.oldX[slot]) * FIXED_ONE,
+                (fixed_t)(entities.y[slot] - entities.oldY[slot]) * FIXED_ONE};
+  int enter = sweepBoxes(a, b, exit);
+  if (enter < 0)
+  {
+    return -1;
+  }
+  fixed_t dx = b.dx - a.dx;
+  fixed_t dy = b.dy - a.dy;
+  fixed_t motion = dx < 0 ? -dx : dx;
+  if ((dy < 0 ? -dy : dy) > motion)
+  {
+    motion = dy < 0 ? -dy : dy;
+  }
+  int samples = 1 + FIXED_TO_INT((int64_t)motion * (exit - enter) / SWEEP_ONE);
+  for (int i = 0; i <= samples; i++)
+  {
+    int t = enter + (exit - enter) * i / samples;
+    if (masksOverlap(*sleigh, sweptX(a, t), sweptY(a, t), *mask, sweptX(b, t), sweptY(b, t)))
+    {
+      return t;
+    }
+  }
+  return -1;
+}
+
+// The sleigh ran into a tree; true when the step's collisions are over
+static bool hitTree(GameData &game)
+{
+  // Collision with tree - set crashed and let sleigh fall
+  game.sleighCrashed = true;
+  game.crashingStartTime = game.simTime;
+  game.sleighY = TO_FIXED(PLAYFIELD_HEIGHT - TREE_HEIGHT - SLEIGH_HITBOX);
+  game.sleighVelocity = -game.sleighVelocity / 2; // Bounce effect
+  return true;
+}
+
+// The sleigh met the flying obstacle in slot; true when the step's collisions are over
+static bool hitObstacle(GameData &game, int slot)
+{
+  // Collision detected - handle based on obstacle type
+  EntityStore &entities = game.entities;
+  uint8_t type = entities.type[slot];
+
+  if (type == TYPE_DUCK)
+  {
+    // Duck: set crashed and let sleigh fall
+    game.sleighCrashed = true;
+    game.crashingStartTime = game.simTime;
+    if (game.sleighVelocity < 0)
+    {
+      game.sleighVelocity = -game.sleighVelocity; // bump downwards
+    }
+    return true;
+  }
+  else if (type == TYPE_FOE)
+  {
+    // Foe: check if we're falling (hitting from above) or flapping
+    if (game.sleighVelocity > 0)
+    {
+      // Falling/moving down - kill the foe
+      entities.stopScrolling(slot);
+      entities.flags[slot] |= ENTITY_FALLING;
+      entities.fallVelocity[slot] = TO_FIXED(2);
+      game.currentScore += 20;
+      // Give sleigh a bounce
+      game.sleighVelocity = TO_FIXED(-3);
+    }
+    else if (!game.sleighCrashed)
+    {
+      // Flapping/moving up - lose points and game over
+      game.currentScore -= 10;
+      if (game.currentScore < 0)
+        game.currentScore = 0;
+      game.sleighCrashed = true;
+      game.crashingStartTime = game.simTime;
+      // Give sleigh a big bounce
+      game.sleighVelocity = TO_FIXED(-6);
+      return true;
+    }
+  }
+  else if (type == TYPE_GIFT)
+  {
+    // Gift: collect for 10 points
+    game.currentScore += 10;
+    game.giftsCollected++;
+    game.lastGiftX = entities.x[slot];
+    game.lastGiftY = entities.y[slot];
+    entities.deactivate(slot);
+    entities.spawnTimer[slot] = game.simTime + gameRandom(game, SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
+  }
+  return false;
+}
+
+void checkCollisions(GameData &game)
+{
+  // ceiling
+  if (game.sleighY < TO_FIXED(2))
+  {
+    game.sleighY = TO_FIXED(2);
+    game.sleighVelocity = -game.sleighVelocity / 3; // Bounce effect
+  }
+  // Ground
+  if (!game.sleighCrashed && game.sleighY >= TO_FIXED(PLAYFIELD_HEIGHT - SLEIGH_HITBOX))
+  {
+    game.sleighY = TO_FIXED(PLAYFIELD_HEIGHT - SLEIGH_HITBOX);
+    game.sleighVelocity = -game.sleighVelocity; // Bounce effect
+    game.sleighCrashed = true;
+    game.crashingStartTime = game.simTime;
+    return;
+  }
+  // Check if crashed sleigh hit the ground - start explosion animation
+  if (game.sleighCrashed && !game.sleighExploding && game.sleighY >= TO_FIXED(PLAYFIELD_HEIGHT - SLEIGH_HITBOX))
+  {
+    game.sleighExploding = true;
+    game.explosionStartTime = game.simTime;
+    game.sleighY = TO_FIXED(PLAYFIELD_HEIGHT - SLEIGH_HITBOX); // Lock at ground
+    game.sleighVelocity = 0;
+    return;
+  }
+
+  // Check if explosion animation is complete (1000 milliseconds)
+  if (game.sleighExploding && game.simTime - game.explosionStartTime >= 1000)
+  {
+    game.state = STATE_GAME_OVER;
+    game.lastStateChange = game.simTime;
+    return;
+  }
+
+  // Sweep every obstacle's motion over the step against the sleigh's, so nothing passes through
+  // it between two steps however fast it goes, then handle the contacts in the order they happened
+  fixed_t sleighMotion = game.sleighY - game.sleighOldY;
+  struct Contact
+  {
+    int time;
+    int slot;
+  };
+  Contact contacts[ENTITY_COUNT];
+  int count = 0;
+
+  // Trees reach from their top down to the ground and meet the sleigh's square hitbox;
+  // flying obstacles meet its full height
+  SweptBox treeSleighBox = {TO_FIXED(SLEIGH_START_X + 2), game.sleighOldY, TO_FIXED(SLEIGH_HITBOX - 2),
+                            TO_FIXED(SLEIGH_HITBOX), 0, sleighMotion};
+  SweptBox flyingSleighBox = treeSleighBox;
+  flyingSleighBox.h = TO_FIXED(SLEIGH_HEIGHT);
+  // Broadphase: only the run of byX whose motion this step spans the sleigh's columns
+  const EntityStore &entities = game.entities;
+  for (int i = 0; i < entities.byXCount; i++)
+  {
+    int slot = entities.ordered(i);
+    int left = entities.x[slot] < entities.oldX[slot] ? entities.x[slot] : entities.oldX[slot];
+    int right = (entities.x[slot] > entities.oldX[slot] ? entities.x[slot] : entities.oldX[slot]) +
+                obstacleWidth(entities.type[slot]);
+    if (left >= SLEIGH_START_X + SLEIGH_WIDTH)
+    {
+      break; // This one and all right of it are still ahead
+    }
+    if (right <= SLEIGH_START_X)
+    {
+      continue; // Already behind
+    }
+    fixed_t x = (fixed_t)entities.oldX[slot] * FIXED_ONE;
+    fixed_t dx = (fixed_t)(entities.x[slot] - entities.oldX[slot]) * FIXED_ONE;
+    int time;
+    if (entities.type[slot] == TYPE_TREE)
+    {
+      SweptBox box = {x, TO_FIXED(PLAYFIELD_HEIGHT - TREE_HEIGHT), TO_FIXED(TREE_WIDTH),
+                      TO_FIXED(TREE_HEIGHT + SCREEN_HEIGHT), dx, 0};
+      time = sleighImpact(game, game.masks ? &game.masks->tree : nullptr, slot, treeSleighBox, box);
+    }
+    else
+    {
+      SweptBox box = {x, (fixed_t)entities.oldY[slot] * FIXED_ONE, TO_FIXED(DUCK_HITBOX), TO_FIXED(DUCK_HEIGHT), dx,
+                      (fixed_t)(entities.y[slot] - entities.oldY[slot]) * FIXED_ONE};
+      const ClipCursor &anim = entities.anim[slot];
+      time = sleighImpact(game, game.masks ? &game.masks->clips[anim.clip][anim.frame] : nullptr, slot, flyingSleighBox, box);
+    }
+    if (time >= 0)
+    {
+      contacts[count++] = {time, slot};
+    }
+  }
+
+  // Earliest first; ties go in slot order, trees before flying obstacles
+  for (int i = 1; i < count; i++)
+  {
+    Contact contact = contacts[i];
+    int j = i;
+    for (; j > 0 && (contacts[j - 1].time > contact.time ||
+                     (contacts[j - 1].time == contact.time && contacts[j - 1].slot > contact.slot));
+         j--)
+    {
+      contacts[j] = contacts[j - 1];
+    }
+    contacts[j] = contact;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    int slot = contacts[i].slot;
+    if (slot < FIRST_FLYING_SLOT ? hitTree(game) : hitObstacle(game, slot))
+    {
+      return;
+    }
+  }
+}
+
+bool updateHighScores(GameData &game)
+{
+  bool newRecord = false;
+  if (!game.highScoreUpdated)
+  {
+    if (game.currentScore > game.sessionHighScore[game.gameMode])
+    {
+      game.sessionHighScore[game.gameMode] = game.currentScore;
+    }
+    if (game.currentScore > game.foreverHighScore[game.gameMode])
+    {
+      game.foreverHighScore[game.gameMode] = game.currentScore;
+      newRecord = true;
+    }
+    game.highScoreUpdated = true;
+  }
+  return newRecord;
+}
+
+// ============================================================================
+// STEP
+// ============================================================================
+
+// Positions at the start of a step are what the renderer interpolates from
+void beginStep(GameData &game)
+{
+  game.simTime += SIM_STEP_MS;
+  game.sleighOldY = game.sleighY;
+  EntityStore &entities = game.entities;
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    entities.oldX[slot] = entities.x[slot];
+    entities.oldY[slot] = entities.y[slot];
+  }
+}
+
+// Advance the game by one fixed step of SIM_STEP_MS
+void stepGame(GameData &game, const StepInput &input)
+{
+  beginStep(game);
+  applyInput(game, input);
+
+  if (game.state == STATE_PLAYING)
+  {
+    updatePhysics(game);
+    updateObstacles(game);
+    updateFlyingAnimation(game);
+    checkCollisions(game);
+    updateScore(game);
+  }
+
+  // Same step as the transition, so the game over panel shows the new records
+  if (game.state == STATE_GAME_OVER)
+  {
+    updateHighScores(game);
+  }
+}
@@ -0,0 +1,335 @@
+/*
+ Flappy Sleigh game core
+ - Pure simulation: no display, no GPIO, no millis() or random()
+ - Time is GameData::simTime, advanced SIM_STEP_MS per step by the caller's loop
+ - Randomness comes from a PRNG seeded into GameData, so a seed and an input
+   sequence always replay the same game
+ - Shared by the ESP32 firmware and the native (host) build
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// ============================================================================
+// CONSTANTS & CONFIGURATION
+// ============================================================================
+
+// Screen dimensions
+#define SCREEN_WIDTH 240
+#define SCREEN_HEIGHT 135
+#define GROUND_HEIGHT 10
+#define PLAYFIELD_HEIGHT (SCREEN_HEIGHT - GROUND_HEIGHT)
+
+// Fixed point (Q16.16) for all simulation motion: deterministic and no floating point on the hot path
+typedef int32_t fixed_t;
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define TO_FIXED(x) ((fixed_t)((x) * FIXED_ONE)) // Constant expressions only: folded at compile time
+#define FIXED_TO_INT(f) ((int)((f) >> FIXED_SHIFT))
+#define FIXED_MUL(a, b) ((fixed_t)(((int64_t)(a) * (b)) >> FIXED_SHIFT))
+
+// Game constants
+#define GRAVITY TO_FIXED(0.3)
+#define JUMP_STRENGTH TO_FIXED(-4.0)
+#define OBSTACLE_SPAWN_DISTANCE 80
+#define OBSTACLE_SPAWN_OFFSET 40
+#define SIM_STEP_MS 33 // Fixed simulation timestep; GRAVITY, JUMP_STRENGTH and speeds are per step
+#define SWEEP_ONE 256 // Collision sweeps resolve when in a step things touch to 1/256 of it
+
+// Sleigh configuration
+#define SLEIGH_WIDTH 20
+#define SLEIGH_HEIGHT 14
+#define SLEIGH_HITBOX 8
+#define SLEIGH_START_X 40
+
+// Tree configuration
+#define TREE_WIDTH 20
+#define TREE_HEIGHT (SCREEN_HEIGHT / 4) // 33 pixels
+#define TREE_COUNT 5
+
+// Duck configuration
+#define DUCK_WIDTH 20
+#define DUCK_HEIGHT 14
+#define DUCK_HITBOX 10
+#define DUCK_COUNT 5
+#define DUCK_FLAP_INTERVAL 500 // milliseconds per frame when a clip does not give its own
+
+// Animation
+#define MAX_CLIP_FRAMES 12
+
+// Gift configuration
+#define GIFT_WIDTH 13
+#define GIFT_HEIGHT 14
+
+// Entity store: trees take the first slots, flying obstacles the rest, and each
+// kind respawns only into its own slots
+#define ENTITY_COUNT (TREE_COUNT + DUCK_COUNT)
+#define FIRST_FLYING_SLOT TREE_COUNT
+
+// Entity flags
+#define ENTITY_ACTIVE 0x01  // In play, and listed in EntityStore::active (and byX unless falling)
+#define ENTITY_SCORED 0x02  // Counted as passed
+#define ENTITY_FALLING 0x04 // Killed foe dropping to the ground: no longer scrolls, collides or scores
+
+// Obstacle spawning configuration
+#define SPAWN_DELAY_MIN 800  // milliseconds
+#define SPAWN_DELAY_MAX 2500 // milliseconds
+
+// ============================================================================
+// ENUMS & STRUCTURES
+// ============================================================================
+
+enum GameState
+{
+  STATE_MENU,     // Waiting for player to start
+  STATE_PLAYING,  // Active gameplay
+  STATE_GAME_OVER // Game ended, showing results
+};
+
+enum GameMode
+{
+  MODE_NORMAL,
+  MODE_SPEED,
+  MODE_CHEAT,
+};
+enum ObstacleType
+{
+  TYPE_DUCK, // Collision = game over
+  TYPE_FOE,  // Hit from above = 20 points, hit while flapping = -10 points + game over
+  TYPE_GIFT, // Hit = 10 points, disappears
+  TYPE_TREE  // Collision = game over, from its top down to the ground
+};
+
+// Animations of the flying obstacles, one per ObstacleType
+enum ClipId
+{
+  CLIP_DUCK,
+  CLIP_FOE,
+  CLIP_GIFT,
+  CLIP_COUNT
+};
+
+// Frame timing of one animation. The frames themselves belong to the renderer,
+// which sets the timing from its sprite metadata with setClip.
+struct AnimationClip
+{
+  uint8_t frameCount;                  // 0 or 1 = not animated
+  uint16_t durations[MAX_CLIP_FRAMES]; // ms per frame
+};
+
+// Where an obstacle is in its clip
+struct ClipCursor
+{
+  uint8_t clip; // ClipId
+  uint8_t frame;
+  uint16_t elapsed; // ms into the frame
+};
+
+// Opaque pixels of one sprite frame, for pixel-exact collisions: a word per row,
+// leftmost pixel in bit 31, so frames are at most 32 pixels wide
+struct CollisionMask
+{
+  const uint32_t *rows; // nullptr = no mask
+  uint8_t width;
+  uint8_t height;
+};
+
+// Masks of every frame the sleigh can collide with, set by the renderer from its sprites.
+// Without a mask on both sides, the hand-tuned hitboxes decide.
+struct CollisionMasks
+{
+  CollisionMask sleigh[2]; // Frame 0 climbing, frame 1 falling, as drawn
+  CollisionMask tree;
+  CollisionMask clips[CLIP_COUNT][MAX_CLIP_FRAMES]; // By ClipCursor
+};
+
+// Every obstacle as a structure of arrays indexed by slot, so each update is one pass over a few
+// contiguous arrays. Slots never move, so the renderer keeps what it drew per slot; active lists
+// the slots in play densely, in no particular order, and updates walk only that.
+// Everything that scrolls moves left by the same amount each step, so the order it spawned in
+// at the right edge is its order across the screen for good. byX is a ring of those slots from
+// left to right: spawns go in at the tail, obstacles leaving the screen come out at the head,
+// and collisions, scoring and spawn spacing look only at the few entries where they apply.
+struct EntityStore
+{
+  int16_t x[ENTITY_COUNT]; // Screen pixels
+  int16_t y[ENTITY_COUNT];
+  int16_t oldX[ENTITY_COUNT]; // At the start of the step, for interpolation and collision sweeps
+  int16_t oldY[ENTITY_COUNT];
+  uint16_t fracX[ENTITY_COUNT]; // Sub-pixel remainders (fixed_t fraction bits) so slow speeds scroll evenly
+  uint16_t fracY[ENTITY_COUNT];
+  uint8_t type[ENTITY_COUNT];  // ObstacleType
+  uint8_t flags[ENTITY_COUNT]; // ENTITY_*
+  ClipCursor anim[ENTITY_COUNT];       // Flying obstacles: animation frame, advanced by updateFlyingAnimation
+  fixed_t fallVelocity[ENTITY_COUNT];  // Falling foes
+  uint32_t spawnTimer[ENTITY_COUNT];   // Slots out of play: when to try to respawn
+  uint16_t active[ENTITY_COUNT];       // Slots in play
+  uint16_t activeIndex[ENTITY_COUNT];  // Where each slot in play is in active
+  uint16_t activeCount;
+  uint16_t byX[ENTITY_COUNT]; // Ring of the slots in play that scroll (not falling), left to right
+  uint16_t byXHead;
+  uint16_t byXCount;
+
+  bool isActive(int slot) const
+  {
+    return flags[slot] & ENTITY_ACTIVE;
+  }
+
+  // Jump to a pixel position with no motion to interpolate and no sub-pixel remainder
+  void place(int slot, int newX, int newY)
+  {
+    x[slot] = oldX[slot] = newX;
+    y[slot] = oldY[slot] = newY;
+    fracX[slot] = fracY[slot] = 0;
+  }
+
+  void move(int slot, fixed_t dx, fixed_t dy = 0)
+  {
+    oldX[slot] = x[slot];
+    oldY[slot] = y[slot];
+    fixed_t fx = (fixed_t)x[slot] * FIXED_ONE + fracX[slot] + dx;
+    fixed_t fy = (fixed_t)y[slot] * FIXED_ONE + fracY[slot] + dy;
+    x[slot] = FIXED_TO_INT(fx);
+    y[slot] = FIXED_TO_INT(fy);
+    fracX[slot] = fx & (FIXED_ONE - 1);
+    fracY[slot] = fy & (FIXED_ONE - 1);
+  }
+
+  // Slot at position i of byX, counted from the head (leftmost)
+  int ordered(int i) const
+  {
+    int at = byXHead + i;
+    return byX[at < ENTITY_COUNT ? at : at - ENTITY_COUNT];
+  }
+
+  // Put a slot in play, unscored. It goes into byX from the tail, which is where it belongs
+  // when it spawns at the right edge.
+  void activate(int slot)
+  {
+    if (isActive(slot))
+    {
+      deactivate(slot);
+    }
+    activeIndex[slot] = activeCount;
+    active[activeCount++] = slot;
+    flags[slot] = ENTITY_ACTIVE;
+    int i = byXCount++;
+    for (; i > 0 && x[ordered(i - 1)] > x[slot]; i--)
+    {
+      setOrdered(i, ordered(i - 1));
+    }
+    setOrdered(i, slot);
+  }
+
+  // Take a slot out of play. The last slot in active takes its place, so a loop over active
+  // that deactivates its current entry goes on from the same index.
+  void deactivate(int slot)
+  {
+    if (isActive(slot))
+    {
+      stopScrolling(slot);
+      uint16_t last = active[--activeCount];
+      active[activeIndex[slot]] = last;
+      activeIndex[last] = activeIndex[slot];
+    }
+    flags[slot] = 0;
+  }
+
+  // Take a slot in play out of byX, for a killed foe that falls instead of scrolling. Slots
+  // leave near the sleigh or at the head, so only the few entries left of it shift up.
+  void stopScrolling(int slot)
+  {
+    if (flags[slot] & ENTITY_FALLING)
+    {
+      return;
+    }
+    int i = 0;
+    while (ordered(i) != slot)
+    {
+      i++;
+    }
+    for (; i > 0; i--)
+    {
+      setOrdered(i, ordered(i - 1));
+    }
+    byXHead = byXHead + 1 < ENTITY_COUNT ? byXHead + 1 : 0;
+    byXCount--;
+  }
+
+  void setOrdered(int i, int slot)
+  {
+    int at = byXHead + i;
+    byX[at < ENTITY_COUNT ? at : at - ENTITY_COUNT] = slot;
+  }
+};
+
+// Button presses that landed in one simulation step
+struct StepInput
+{
+  bool button1;          // Flap / start / restart
+  bool button2;          // Change mode in the menu / restart
+  fixed_t pressFraction; // How far into the step the press happened, 0..FIXED_ONE
+};
+
+// Unified game state structure
+struct GameData
+{
+  // Game state
+  GameState state;
+  uint32_t lastStateChange;
+  uint32_t simTime;  // Simulation clock in ms, advanced SIM_STEP_MS per step
+  uint32_t rngState; // Seeded PRNG; the only source of randomness in the simulation
+
+  // Player physics
+  fixed_t sleighY;
+  fixed_t sleighVelocity;
+  fixed_t sleighOldY;
+  fixed_t pendingFlap;         // Fraction of the current step at which a flap happened, -1 if none
+  bool sleighCrashed;          // Whether sleigh has crashed and is falling to ground
+  uint32_t crashingStartTime;  // When crashing animation started
+  bool sleighExploding;        // Whether sleigh is exploding (1 second animation)
+  uint32_t explosionStartTime; // When explosion animation started
+
+  GameMode gameMode; // Current game mode
+
+  // Score & high scores
+  int currentScore;
+  int sessionHighScore[MODE_CHEAT + 1];
+  int foreverHighScore[MODE_CHEAT + 1];
+
+  // Animation & rendering
+  AnimationClip clips[CLIP_COUNT]; // Set by setClip; kept across restarts
+  const CollisionMasks *masks;     // nullptr = hitboxes only; kept across restarts
+  bool highScoreUpdated;
+
+  // Events for the renderer. Counter only ever grows, so a skipped snapshot loses no burst.
+  uint16_t giftsCollected;
+  int16_t lastGiftX;
+  int16_t lastGiftY;
+
+  // Obstacles
+  EntityStore entities;
+};
+
+// ============================================================================
+// SIMULATION
+// ============================================================================
+
+void seedGame(GameData &game, uint32_t seed);
+uint32_t gameRandom(GameData &game, uint32_t min, uint32_t max); // [min, max), like Arduino's random()
+void initializeGameData(GameData &game);                         // Keeps the seed, mode, high scores, clips and masks
+void setClip(GameData &game, ClipId clip, const uint16_t *durations, int frameCount);
+
+// One fixed step, in order. stepGame runs them all; callers that time each
+// phase (the firmware profiler) call them one by one in the same order.
+void beginStep(GameData &game);
+void applyInput(GameData &game, const StepInput &input);
+void updatePhysics(GameData &game);
+void updateObstacles(GameData &game);
+void updateFlyingAnimation(GameData &game);
+void checkCollisions(GameData &game);
+void updateScore(GameData &game);
+bool updateHighScores(GameData &game); // True when a forever record was beaten and needs saving
+
+void stepGame(GameData &game, const StepInput &input);
@@ -0,0 +1,329 @@
+#include "SpriteAtlas.h"
+
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bytes per row of a frame's pixel data, 0 for an unknown format
+static size_t rowBytes(uint8_t format, int width)
+{
+  switch (format)
+  {
+  case ATLAS_FORMAT_RGB565:
+    return width * 2;
+  case ATLAS_FORMAT_INDEXED4:
+    return (width + 1) / 2;
+  case ATLAS_FORMAT_INDEXED8:
+    return width;
+  default:
+    return 0;
+  }
+}
+
+// Whether an RLE frame's row table and runs stay inside the frame's width and the atlas.
+// Every bound is checked as a length against the bytes left, so no offset can wrap around.
+static bool validateRle(const AtlasEntry &entry, const uint8_t *data, size_t size)
+{
+  if (entry.colors == 0 || entry.colors > 256 || entry.offset % 2 != 0 || entry.offset > size ||
+      entry.colors * 2 + entry.h * 2 > size - entry.offset)
+  {
+    return false;
+  }
+  size_t runsStart = entry.offset + entry.colors * 2 + entry.h * 2;
+  const uint16_t *rows = (const uint16_t *)(data + entry.offset + entry.colors * 2);
+  for (int y = 0; y < entry.h; y++)
+  {
+    if (rows[y] > size - runsStart)
+    {
+      return false;
+    }
+    size_t at = runsStart + rows[y];
+    int x = 0;
+    for (;;)
+    {
+      if (size - at < 2)
+      {
+        return false;
+      }
+      int skip = data[at];
+      int count = data[at + 1];
+      if (count == 0)
+      {
+        break;
+      }
+      x += skip + count;
+      if (x > entry.w || (size_t)count > size - at - 2)
+      {
+        return false;
+      }
+      at += 2 + count;
+      for (size_t i = at - count; i < at; i++)
+      {
+        if (data[i] >= entry.colors)
+        {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool validateAtlas(const uint8_t *data, size_t size)
+{
+  if (data == nullptr || size < sizeof(AtlasHeader))
+  {
+    return false;
+  }
+  const AtlasHeader *header = (const AtlasHeader *)data;
+  const AtlasEntry *entries = (const AtlasEntry *)(header + 1);
+  if (memcmp(header->magic, ATLAS_MAGIC, sizeof(header->magic)) != 0 || header->version != ATLAS_VERSION ||
+      header->byteOrder != ATLAS_ORDER_PANEL || header->entrySize != sizeof(AtlasEntry) || header->size > size ||
+      header->size < sizeof(AtlasHeader) + header->count * sizeof(AtlasEntry))
+  {
+    return false;
+  }
+  for (int i = 0; i < header->count; i++)
+  {
+    const AtlasEntry &entry = entries[i];
+    if (entry.name[ATLAS_NAME_LENGTH - 1] != '\0' ||
+        (entry.mask != 0 && (entry.mask % 4 != 0 || entry.w > 32 || entry.mask > header->size ||
+                             entry.h * sizeof(uint32_t) > header->size - entry.mask)))
+    {
+      return false;
+    }
+    if (entry.format == ATLAS_FORMAT_RLE)
+    {
+      if (!validateRle(entry, data, header->size))
+      {
+        return false;
+      }
+      continue;
+    }
+    size_t maxColors = entry.format == ATLAS_FORMAT_INDEXED4 ? 16 : entry.format == ATLAS_FORMAT_INDEXED8 ? 256 : 0;
+    uint64_t bytes = entry.colors * 2 + (uint64_t)rowBytes(entry.format, entry.w) * entry.h; // Can pass 4 GB
+    if (rowBytes(entry.format, entry.w) == 0 || entry.colors > maxColors || (maxColors > 0 && entry.colors == 0) ||
+        entry.offset % 2 != 0 || entry.offset > header->size || bytes > header->size - entry.offset)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SpriteAtlas::image(int index, SpriteImage &image) const
+{
+  const AtlasEntry &entry = this->entry(index);
+  const uint8_t *frame = data + entry.offset;
+  image = {};
+  image.width = entry.w;
+  image.height = entry.h;
+  image.format = entry.format;
+  image.mask = entry.mask != 0 ? (const uint32_t *)(data + entry.mask) : nullptr;
+  if (entry.format == ATLAS_FORMAT_RGB565)
+  {
+    image.pixels = (const uint16_t *)frame;
+    image.stride = entry.w;
+  }
+  else if (entry.format == ATLAS_FORMAT_RLE)
+  {
+    image.palette = (const uint16_t *)frame;
+    image.colors = entry.colors;
+    image.rows = (const uint16_t *)(frame + entry.colors * 2);
+    image.indices = frame + entry.colors * 2 + entry.h * 2;
+  }
+  else
+  {
+    image.palette = (const uint16_t *)frame;
+    image.colors = entry.colors;
+    image.indices = frame + entry.colors * 2;
+    image.stride = rowBytes(entry.format, entry.w);
+  }
+}
+
+bool SpriteAtlas::find(const char *name, SpriteImage &image) const
+{
+  for (int i = 0; i < count(); i++)
+  {
+    if (strncmp(entry(i).name, name, ATLAS_NAME_LENGTH) == 0)
+    {
+      this->image(i, image);
+      return true;
+    }
+  }
+  return false;
+}
+
+#if defined(ESP_PLATFORM)
+bool mapAtlas(SpriteAtlas &atlas, const char *source)
+{
+  atlas = {};
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, source);
+  if (partition == nullptr)
+  {
+    return false;
+  }
+  // Reads go through the flash cache; nothing is copied to RAM
+  const void *data;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &data, &handle) != ESP_OK)
+  {
+    return false;
+  }
+  if (!validateAtlas((const uint8_t *)data, partition->size))
+  {
+    spi_flash_munmap(handle);
+    return false;
+  }
+  atlas = {(const uint8_t *)data, partition->size, (uintptr_t)handle};
+  return true;
+}
+
+void unmapAtlas(SpriteAtlas &atlas)
+{
+  if (atlas.data != nullptr)
+  {
+    spi_flash_munmap((spi_flash_mmap_handle_t)atlas.mapping);
+  }
+  atlas = {};
+}
+#else
+bool mapAtlas(SpriteAtlas &atlas, const char *source)
+{
+  atlas = {};
+  int fd = open(source, O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd); // The mapping stays valid after the descriptor is closed
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  if (!validateAtlas((const uint8_t *)data, info.st_size))
+  {
+    munmap(data, info.st_size);
+    return false;
+  }
+  atlas = {(const uint8_t *)data, (size_t)info.st_size, (uintptr_t)data};
+  return true;
+}
+
+void unmapAtlas(SpriteAtlas &atlas)
+{
+  if (atlas.data != nullptr)
+  {
+    munmap((void *)atlas.mapping, atlas.size);
+  }
+  atlas = {};
+}
+#endif
+
+// Write the opaque pixels of row y that fall in columns left .. right - 1 to out[column - left]
+static void expandRuns(const SpriteImage &image, int y, int left, int right, uint16_t *out, const uint16_t *palette)
+{
+  const uint8_t *run = image.indices + image.rows[y];
+  int x = 0;
+  while (run[1] != 0 && x < right)
+  {
+    x += run[0];
+    int count = run[1];
+    const uint8_t *indices = run + 2;
+    run += 2 + count;
+    int from = x > left ? x : left;
+    int to = x + count < right ? x + count : right;
+    for (int i = from; i < to; i++)
+    {
+      out[i - left] = palette[indices[i - x]];
+    }
+    x += count;
+  }
+}
+
+const uint16_t *imageRow(const SpriteImage &image, int y, int left, int count, uint16_t *scratch,
+                         const uint16_t *palette)
+{
+  if (image.format == ATLAS_FORMAT_RGB565)
+  {
+    return image.row(y) + left;
+  }
+  if (palette == nullptr)
+  {
+    palette = image.palette;
+  }
+  if (image.format == ATLAS_FORMAT_RLE)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      scratch[i] = palette[0];
+    }
+    expandRuns(image, y, left, left + count, scratch, palette);
+    return scratch;
+  }
+  const uint8_t *line = image.indices + y * image.stride;
+  if (image.format == ATLAS_FORMAT_INDEXED8)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      scratch[i] = palette[line[left + i]];
+    }
+    return scratch;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    int x = left + i;
+    scratch[i] = palette[x & 1 ? line[x >> 1] & 0x0F : line[x >> 1] >> 4];
+  }
+  return scratch;
+}
+
+void blitImage(const SpriteImage &image, int x, int y, uint16_t *buffer, int bufferWidth, int bufferY, int bufferHeight,
+               const uint16_t *palette)
+{
+  if (image.empty())
+  {
+    return;
+  }
+  int top = y > bufferY ? y : bufferY;
+  int bottom = y + image.height < bufferY + bufferHeight ? y + image.height : bufferY + bufferHeight;
+  int left = x > 0 ? x : 0;
+  int right = x + image.width < bufferWidth ? x + image.width : bufferWidth;
+  if (top >= bottom || left >= right)
+  {
+    return;
+  }
+  if (image.format == ATLAS_FORMAT_RLE)
+  {
+    for (int row = top; row < bottom; row++)
+    {
+      // Only the opaque runs are written; the buffer shows through the skips
+      expandRuns(image, row - y, left - x, right - x, buffer + (row - bufferY) * bufferWidth + left,
+                 palette != nullptr ? palette : image.palette);
+    }
+    return;
+  }
+  for (int row = top; row < bottom; row++)
+  {
+    // Indexed rows expand straight into the buffer; RGB565 rows are copied
+    uint16_t *line = buffer + (row - bufferY) * bufferWidth + left;
+    const uint16_t *source = imageRow(image, row - y, left - x, right - left, line, palette);
+    if (source != line)
+    {
+      memcpy(line, source, (right - left) * sizeof(uint16_t));
+    }
+  }
+}
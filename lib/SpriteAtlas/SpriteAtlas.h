@@ -0,0 +1,151 @@
+/*
+ Sprite atlas
+ - An index of named frames plus their pixel data (built by convert_sprite.py --atlas)
+ - Frames are RGB565, or 4/8 bit palette indices expanded through a lookup table at blit
+   time; swapping that table recolours a sprite without touching its pixels
+ - Frames named <clip>0, <clip>1, ... with a duration each make up an animation clip
+ - Frames up to 32 pixels wide carry a collision mask: one bit per opaque pixel
+ - RLE frames store only their opaque runs, so composed blits skip transparent spans
+   and draw over whatever is already in the buffer
+ - Mapped straight into the address space: esp_partition_mmap of the "sprites"
+   flash partition on the ESP32, POSIX mmap of the atlas file on the host
+ - Sprites are views into the mapping, so pixel data is never copied to RAM
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ATLAS_MAGIC "SPAT"
+#define ATLAS_VERSION 5
+#define ATLAS_NAME_LENGTH 16
+#define ATLAS_FORMAT_RGB565 0          // Big-endian RGB565, the panel's byte order
+#define ATLAS_FORMAT_INDEXED4 1        // Palette, then two pixels per byte (left one in the high nibble)
+#define ATLAS_FORMAT_INDEXED8 2        // Palette, then one pixel per byte
+#define ATLAS_FORMAT_RLE 3             // Palette (entry 0 = background), u16 offset of each row's runs,
+                                       // then per row: (skip, count, count indices) runs ending with count 0
+#define ATLAS_ORDER_PANEL 1           // RGB565 stored high byte first, as the panel takes it over SPI
+#define ATLAS_PARTITION_LABEL "sprites" // Flash data partition holding the atlas (partitions.csv)
+
+// Atlas file layout: header, one entry per frame, then each frame's data.
+// Single-frame .bin files from convert_sprite.py use the same layout.
+struct AtlasHeader
+{
+  char magic[4]; // ATLAS_MAGIC
+  uint16_t version;
+  uint16_t count;     // Entries
+  uint32_t size;      // Bytes in the whole atlas, header included
+  uint8_t byteOrder;  // ATLAS_ORDER_PANEL: pixels and palettes go to the panel without a swap
+  uint8_t entrySize;  // sizeof(AtlasEntry)
+  uint16_t reserved;
+};
+
+struct AtlasEntry
+{
+  char name[ATLAS_NAME_LENGTH]; // NUL terminated and padded, e.g. "sleigh0"
+  uint32_t offset;              // Frame data from the start of the atlas: palette (indexed formats), then rows
+  uint32_t mask;                // Collision mask from the start of the atlas: h u32 rows, leftmost
+                                // pixel in bit 31, set where opaque; 0 = none (frames over 32 wide)
+  uint16_t w;
+  uint16_t h;
+  uint16_t colors;   // Palette entries, big-endian RGB565; 0 for RGB565 frames
+  uint16_t duration; // ms this frame shows in its clip's animation; 0 = the game's default
+  uint8_t format;
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(AtlasHeader) == 16 && sizeof(AtlasEntry) == 36, "atlas structs must match the file layout");
+
+// A sprite's pixels wherever they live (mapped flash or RAM): height rows of
+// width pixels, each row stride pixels (RGB565) or stride bytes (indexed) after the previous one
+struct SpriteImage
+{
+  const uint16_t *pixels; // ATLAS_FORMAT_RGB565: colours in the panel's byte order
+  int16_t width;
+  int16_t height;
+  int16_t stride;
+  uint8_t format;          // ATLAS_FORMAT_*
+  const uint8_t *indices;  // Indexed formats: palette index of each pixel
+  const uint16_t *palette; // Indexed formats: colours in the panel's byte order
+  uint16_t colors;         // Palette entries
+  const uint16_t *rows;    // ATLAS_FORMAT_RLE: offset of each row's runs from indices
+  const uint32_t *mask;    // Opaque pixels, a word per row with the leftmost in bit 31; nullptr if none
+
+  bool empty() const
+  {
+    return pixels == nullptr && indices == nullptr;
+  }
+
+  // RGB565 frames only
+  const uint16_t *row(int y) const
+  {
+    return pixels + y * stride;
+  }
+};
+
+// An RGB565 image over pixels in RAM (panel byte order), e.g. a sprite drawn at boot or part of a
+// frame buffer
+inline SpriteImage rgb565Image(const uint16_t *pixels, int width, int height, int stride)
+{
+  SpriteImage image = {};
+  image.pixels = pixels;
+  image.width = width;
+  image.height = height;
+  image.stride = stride;
+  image.format = ATLAS_FORMAT_RGB565;
+  return image;
+}
+
+// A validated atlas mapped read-only into memory
+struct SpriteAtlas
+{
+  const uint8_t *data;
+  size_t size;
+  uintptr_t mapping; // Platform handle for unmapAtlas
+
+  const AtlasHeader *header() const
+  {
+    return (const AtlasHeader *)data;
+  }
+
+  // Frames, for enumerating the atlas: 0 when nothing is mapped
+  int count() const
+  {
+    return data != nullptr ? header()->count : 0;
+  }
+
+  const AtlasEntry &entry(int index) const
+  {
+    return ((const AtlasEntry *)(header() + 1))[index];
+  }
+
+  // Point an image at frame index < count()
+  void image(int index, SpriteImage &image) const;
+
+  // Point an image at a named frame; false if there is no such frame
+  bool find(const char *name, SpriteImage &image) const;
+};
+
+// Map the atlas from a flash partition label (ESP32) or a file path (host).
+// False, with the atlas left empty, when it is missing or malformed.
+bool mapAtlas(SpriteAtlas &atlas, const char *source);
+void unmapAtlas(SpriteAtlas &atlas);
+
+// Whether size bytes at data hold a well-formed atlas of this version and byte order,
+// with every frame inside the packed image
+bool validateAtlas(const uint8_t *data, size_t size);
+
+// Pixels left .. left + count - 1 of row y in the panel's byte order. RGB565 rows are
+// returned in place; indexed rows are expanded into scratch through palette (a recoloured
+// copy of the image's palette with as many entries), or the image's own when nullptr.
+// Transparent pixels of RLE rows come out as palette entry 0, the background.
+const uint16_t *imageRow(const SpriteImage &image, int y, int left, int count, uint16_t *scratch,
+                         const uint16_t *palette = nullptr);
+
+// Copy the part of an image placed at screen (x, y) that falls inside a buffer
+// bufferWidth pixels wide holding screen rows bufferY .. bufferY + bufferHeight - 1.
+// palette replaces an indexed image's own palette, as for imageRow. Transparent spans of
+// RLE images are skipped, leaving the buffer's pixels.
+void blitImage(const SpriteImage &image, int x, int y, uint16_t *buffer, int bufferWidth, int bufferY, int bufferHeight,
+               const uint16_t *palette = nullptr);
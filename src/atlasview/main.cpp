@@ -0,0 +1,246 @@
+/*
+ Host check for the sprite atlas (pio run -e atlasview, then .pio/build/atlasview/program [atlas] [out.ppm])
+ - Maps the same image that is flashed to the sprites partition, with POSIX mmap
+ - Lists its frames (with their animation timing) and checks that clipped blits copy exactly the visible pixels,
+   expanding indexed frames through their palette and leaving RLE skips untouched, and that
+   RLE frames' collision masks match their opaque pixels
+ - Checks that truncated atlases, and entries whose offsets would wrap around the address
+   space, are rejected
+ - Composes every frame onto a screen-sized buffer and writes it as a PPM to look at
+ */
+
+#include <SpriteAtlas.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VIEW_WIDTH 240
+#define VIEW_HEIGHT 135
+#define VIEW_BACKGROUND 0x9F3A // Sky blue in the panel's byte order
+
+// Pixel (x, y) of a frame, decoded on its own without imageRow; false where an RLE frame is transparent
+bool framePixel(const SpriteImage &image, int x, int y, uint16_t &color)
+{
+  switch (image.format)
+  {
+  case ATLAS_FORMAT_INDEXED4:
+  {
+    uint8_t pair = image.indices[y * image.stride + x / 2];
+    color = image.palette[x % 2 == 0 ? pair >> 4 : pair & 0x0F];
+    return true;
+  }
+  case ATLAS_FORMAT_INDEXED8:
+    color = image.palette[image.indices[y * image.stride + x]];
+    return true;
+  case ATLAS_FORMAT_RLE:
+  {
+    const uint8_t *run = image.indices + image.rows[y];
+    int start = 0;
+    while (run[1] != 0)
+    {
+      start += run[0];
+      if (x >= start && x < start + run[1])
+      {
+        color = image.palette[run[2 + x - start]];
+        return true;
+      }
+      start += run[1];
+      run += 2 + run[1];
+    }
+    return false;
+  }
+  default:
+    color = image.row(y)[x];
+    return true;
+  }
+}
+
+// Blit a frame at an offset that clips it on the left and top, then compare
+// every pixel of the buffer against the frame read directly
+bool checkClippedBlit(const SpriteImage &image)
+{
+  static uint16_t buffer[VIEW_WIDTH * VIEW_HEIGHT];
+  int x = -image.width / 2;
+  int y = -image.height / 3;
+  for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; i++)
+  {
+    buffer[i] = VIEW_BACKGROUND;
+  }
+  blitImage(image, x, y, buffer, VIEW_WIDTH, 0, VIEW_HEIGHT);
+
+  for (int row = 0; row < VIEW_HEIGHT; row++)
+  {
+    for (int col = 0; col < VIEW_WIDTH; col++)
+    {
+      bool inside = col - x < image.width && row - y >= 0 && row - y < image.height && col - x >= 0;
+      uint16_t expected = VIEW_BACKGROUND;
+      if (inside)
+      {
+        framePixel(image, col - x, row - y, expected);
+      }
+      if (buffer[row * VIEW_WIDTH + col] != expected)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Whether an RLE frame's collision mask has exactly its opaque pixels set (other formats have no
+// transparency to compare against, so any mask passes)
+bool checkMask(const SpriteImage &image)
+{
+  if (image.mask == nullptr || image.format != ATLAS_FORMAT_RLE)
+  {
+    return true;
+  }
+  for (int y = 0; y < image.height; y++)
+  {
+    for (int x = 0; x < image.width; x++)
+    {
+      uint16_t color;
+      bool set = (image.mask[y] >> (31 - x)) & 1;
+      if (set != framePixel(image, x, y, color))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Whether validateAtlas rejects broken copies of a good atlas: cut short (with and without the
+// header's size agreeing), and with each entry's frame or mask offset near the top of a 32 bit
+// address space, where adding a length to it would wrap around
+bool checkMalformed(const SpriteAtlas &atlas)
+{
+  size_t size = atlas.header()->size;
+  uint8_t *copy = (uint8_t *)malloc(size);
+  if (copy == nullptr)
+  {
+    return false;
+  }
+  AtlasHeader *header = (AtlasHeader *)copy;
+  AtlasEntry *entries = (AtlasEntry *)(header + 1);
+  bool rejected = true;
+
+  memcpy(copy, atlas.data, size);
+  rejected &= !validateAtlas(copy, size / 2);
+  header->size = size / 2;
+  rejected &= !validateAtlas(copy, size / 2);
+
+  for (int i = 0; i < atlas.count(); i++)
+  {
+    memcpy(copy, atlas.data, size);
+    entries[i].offset = 0xFFFFFFF0;
+    rejected &= !validateAtlas(copy, size);
+    memcpy(copy, atlas.data, size);
+    entries[i].mask = 0xFFFFFFF0;
+    rejected &= !validateAtlas(copy, size);
+  }
+
+  memcpy(copy, atlas.data, size);
+  rejected &= validateAtlas(copy, size); // The untouched copy still passes
+  free(copy);
+  return rejected;
+}
+
+// Write a buffer of panel-order RGB565 as a binary PPM
+bool writePpm(const char *path, const uint16_t *buffer)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", VIEW_WIDTH, VIEW_HEIGHT);
+  for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; i++)
+  {
+    uint16_t color = (uint16_t)((buffer[i] >> 8) | (buffer[i] << 8));
+    uint8_t rgb[3] = {(uint8_t)((color >> 11) << 3), (uint8_t)(((color >> 5) & 0x3F) << 2), (uint8_t)((color & 0x1F) << 3)};
+    fwrite(rgb, 1, sizeof(rgb), file);
+  }
+  return fclose(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = argc > 1 ? argv[1] : "data/sprites.atlas";
+  const char *output = argc > 2 ? argv[2] : "atlas.ppm";
+
+  SpriteAtlas atlas;
+  if (!mapAtlas(atlas, path))
+  {
+    fprintf(stderr, "%s: missing or not a valid sprite atlas\n", path);
+    return 1;
+  }
+  printf("%s: %d frames, %lu bytes mapped\n", path, atlas.count(), (unsigned long)atlas.size);
+
+  static uint16_t view[VIEW_WIDTH * VIEW_HEIGHT];
+  for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; i++)
+  {
+    view[i] = VIEW_BACKGROUND;
+  }
+
+  int failures = 0;
+  int x = 4;
+  int y = 4;
+  for (int i = 0; i < atlas.count(); i++)
+  {
+    const AtlasEntry &entry = atlas.entry(i);
+    SpriteImage image;
+    bool found = atlas.find(entry.name, image);
+    bool clipped = found && checkClippedBlit(image);
+    bool masked = found && checkMask(image);
+    static const char *formats[] = {"rgb565", "indexed4", "indexed8", "rle"};
+    printf("  %-16s %3ux%-3u %-8s %3u colours at %5lu %5u ms %-4s  %s\n", entry.name, entry.w, entry.h,
+           entry.format < 4 ? formats[entry.format] : "?", entry.colors, (unsigned long)entry.offset, entry.duration,
+           entry.mask != 0 ? "mask" : "", !found ? "NOT FOUND" : !clipped ? "CLIP MISMATCH" : !masked ? "MASK MISMATCH" : "ok");
+    failures += !clipped || !masked;
+
+    if (!found)
+    {
+      continue;
+    }
+    if (x + image.width > VIEW_WIDTH)
+    {
+      x = 4;
+      y += 40;
+    }
+    blitImage(image, x, y, view, VIEW_WIDTH, 0, VIEW_HEIGHT);
+    // And again overlapping the previous frame one row down, to show transparent spans
+    blitImage(image, x / 2, y + 60, view, VIEW_WIDTH, 0, VIEW_HEIGHT);
+    x += image.width + 4;
+  }
+
+  // One more copy of the first frame hanging off the bottom right corner
+  if (atlas.count() > 0)
+  {
+    SpriteImage corner;
+    atlas.image(0, corner);
+    blitImage(corner, VIEW_WIDTH - corner.width / 2, VIEW_HEIGHT - corner.height / 2, view, VIEW_WIDTH, 0, VIEW_HEIGHT);
+  }
+
+  if (!checkMalformed(atlas))
+  {
+    printf("a truncated or wrapping atlas was accepted\n");
+    failures++;
+  }
+  else
+  {
+    printf("truncated and wrapping atlases rejected\n");
+  }
+
+  if (!writePpm(output, view))
+  {
+    fprintf(stderr, "%s: cannot write\n", output);
+    failures++;
+  }
+  else
+  {
+    printf("wrote %s\n", output);
+  }
+  unmapAtlas(atlas);
+  return failures == 0 ? 0 : 1;
+}
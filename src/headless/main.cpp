@@ -0,0 +1,248 @@
+/*
+ Headless runner for the game core (pio run -e native, then .pio/build/native/program [games])
+ - Plays full games with a simple autopilot, as fast as the host allows
+ - Prints games per second and score statistics per mode, for balancing
+ - Replays a game with the same seed to check the simulation is deterministic
+ - Scrolls trees and ducks past the sleigh through the real obstacle step, at every cheat mode
+   speed up to the highest score the games reached, and drops the sleigh through ducks, to check
+   that collisions are swept and nothing tunnels through, with hitboxes and with masks
+ */
+
+#include <GameCore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#define DEFAULT_GAMES 1000                     // Games per mode
+#define MAX_GAME_STEPS (10 * 60 * 1000 / SIM_STEP_MS) // Give up on a game after 10 simulated minutes
+#define AUTOPILOT_LOOKAHEAD 60                  // Pixels ahead of the sleigh the autopilot plans for
+#define TUNNEL_DUCK_Y 40                        // Height of the duck the tunnelling check aims at
+
+struct GameResult
+{
+  int score;
+  uint32_t steps;
+  uint32_t checksum; // Mix of the final state, to compare replays
+};
+
+// Height the sleigh should hold for the obstacles coming up: above trees, clear of ducks, onto gifts
+int autopilotTarget(const GameData &game)
+{
+  int target = PLAYFIELD_HEIGHT / 2;
+  const EntityStore &entities = game.entities;
+  for (int slot = 0; slot < FIRST_FLYING_SLOT; slot++)
+  {
+    int x = entities.x[slot];
+    if (entities.isActive(slot) && x + TREE_WIDTH >= SLEIGH_START_X && x < SLEIGH_START_X + AUTOPILOT_LOOKAHEAD)
+    {
+      int clear = PLAYFIELD_HEIGHT - TREE_HEIGHT - SLEIGH_HITBOX - 12;
+      if (target > clear)
+        target = clear;
+    }
+  }
+
+  for (int slot = FIRST_FLYING_SLOT; slot < ENTITY_COUNT; slot++)
+  {
+    int x = entities.x[slot];
+    int y = entities.y[slot];
+    if (!entities.isActive(slot) || (entities.flags[slot] & ENTITY_FALLING) ||
+        x + DUCK_WIDTH < SLEIGH_START_X || x >= SLEIGH_START_X + AUTOPILOT_LOOKAHEAD)
+    {
+      continue;
+    }
+    if (entities.type[slot] == TYPE_GIFT)
+    {
+      return y;
+    }
+    // Pass above the duck when there is room, below it otherwise
+    if (target + SLEIGH_HEIGHT > y - 4 && target < y + DUCK_HEIGHT + 4)
+    {
+      target = y > SLEIGH_HEIGHT + 12 ? y - SLEIGH_HEIGHT - 6 : y + DUCK_HEIGHT + 6;
+    }
+  }
+  return target;
+}
+
+// Flap when the sleigh sinks below its target
+bool autopilot(const GameData &game)
+{
+  return FIXED_TO_INT(game.sleighY) > autopilotTarget(game) && game.sleighVelocity >= 0;
+}
+
+GameResult playGame(GameMode mode, uint32_t seed)
+{
+  static GameData game;
+  memset(&game, 0, sizeof(game));
+  static const uint16_t flap[2] = {DUCK_FLAP_INTERVAL, DUCK_FLAP_INTERVAL}; // The procedural sprites' timing
+  setClip(game, CLIP_DUCK, flap, 2);
+  setClip(game, CLIP_FOE, flap, 2);
+  game.gameMode = mode;
+  seedGame(game, seed);
+  initializeGameData(game);
+
+  StepInput start = {true, false, 0};
+  stepGame(game, start); // Leave the menu
+  uint32_t steps = 1;
+  while (game.state == STATE_PLAYING && steps < MAX_GAME_STEPS)
+  {
+    StepInput input = {autopilot(game), false, FIXED_ONE / 2};
+    stepGame(game, input);
+    steps++;
+  }
+
+  uint32_t checksum = game.rngState;
+  checksum = checksum * 31 + (uint32_t)game.currentScore;
+  checksum = checksum * 31 + game.simTime;
+  checksum = checksum * 31 + (uint32_t)game.sleighY;
+  return {game.currentScore, steps, checksum};
+}
+
+// A cheat mode game at a score, with nothing in play or due to spawn but one obstacle at x (a
+// tree in slot 0 or a duck at height y), and the sleigh at sleighY
+void placeObstacle(GameData &game, const CollisionMasks *masks, int score, bool tree, int x, int y, int sleighY)
+{
+  memset(&game, 0, sizeof(game));
+  static const uint16_t flap[2] = {DUCK_FLAP_INTERVAL, DUCK_FLAP_INTERVAL};
+  setClip(game, CLIP_DUCK, flap, 2);
+  game.masks = masks;
+  seedGame(game, 1);
+  initializeGameData(game);
+  game.state = STATE_PLAYING;
+  game.gameMode = MODE_CHEAT;
+  game.currentScore = score;
+  EntityStore &entities = game.entities;
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    entities.deactivate(slot);
+    entities.spawnTimer[slot] = UINT32_MAX;
+  }
+  int slot = tree ? 0 : FIRST_FLYING_SLOT;
+  entities.place(slot, x, tree ? PLAYFIELD_HEIGHT - TREE_HEIGHT : y);
+  entities.activate(slot);
+  entities.type[slot] = tree ? TYPE_TREE : TYPE_DUCK;
+  entities.anim[slot] = {CLIP_DUCK, 0, 0};
+  game.sleighY = game.sleighOldY = (fixed_t)sleighY * FIXED_ONE;
+}
+
+// Whether every tree and duck scrolling past the sleigh, at the cheat mode speed of every score
+// up to maxScore and every phase, and every fall of the sleigh through a duck at as many px per
+// step, ends in a crash
+bool checkTunnelling(const CollisionMasks *masks, int maxScore)
+{
+  static GameData game;
+  for (int score = 0; score <= maxScore; score++)
+  {
+    int speed = FIXED_TO_INT(TO_FIXED(8) + score * (FIXED_ONE / 20)) + 1; // Rounded up, to cover every phase
+    for (int phase = 0; phase < speed; phase++)
+    {
+      // A tree, then a duck, scrolls left at sleigh height through the same steps as a game, from
+      // just clear of the sleigh's hitbox until it is retired
+      for (int tree = 1; tree >= 0; tree--)
+      {
+        placeObstacle(game, masks, score, tree, SLEIGH_START_X + SLEIGH_HITBOX + phase, TUNNEL_DUCK_Y,
+                      tree ? PLAYFIELD_HEIGHT - TREE_HEIGHT : TUNNEL_DUCK_Y);
+        while (!game.sleighCrashed && game.entities.activeCount > 0)
+        {
+          beginStep(game);
+          updateObstacles(game);
+          checkCollisions(game);
+        }
+        if (!game.sleighCrashed)
+        {
+          printf("%s at score %d (%d px/step), phase %d: passed through the sleigh\n", tree ? "tree" : "duck", score,
+                 speed, phase);
+          return false;
+        }
+      }
+
+      // The sleigh falls from just above a duck to wherever one step takes it, below it at high speed
+      int top = TUNNEL_DUCK_Y - SLEIGH_HEIGHT - phase;
+      if (top < 2)
+      {
+        continue;
+      }
+      placeObstacle(game, masks, score, false, SLEIGH_START_X, TUNNEL_DUCK_Y, top);
+      game.sleighVelocity = (fixed_t)speed * FIXED_ONE;
+      game.sleighY += game.sleighVelocity;
+      checkCollisions(game);
+      if (!game.sleighCrashed)
+      {
+        printf("sleigh falling at %d px/step, phase %d: passed through the duck\n", speed, phase);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  int games = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+  if (games <= 0)
+  {
+    fprintf(stderr, "usage: %s [games per mode]\n", argv[0]);
+    return 2;
+  }
+
+  static const char *names[MODE_CHEAT + 1] = {"normal", "speed", "cheat"};
+  int maxCheatScore = 0;
+  printf("mode      games   games/s   mean score   max score   mean steps\n");
+  for (int mode = MODE_NORMAL; mode <= MODE_CHEAT; mode++)
+  {
+    uint64_t totalScore = 0;
+    uint64_t totalSteps = 0;
+    int maxScore = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < games; i++)
+    {
+      GameResult result = playGame((GameMode)mode, i + 1);
+      totalScore += result.score;
+      totalSteps += result.steps;
+      if (result.score > maxScore)
+        maxScore = result.score;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (mode == MODE_CHEAT)
+      maxCheatScore = maxScore;
+    printf("%-8s %6d %9.0f %12.2f %11d %12.1f\n", names[mode], games, seconds > 0 ? games / seconds : 0.0,
+           (double)totalScore / games, maxScore, (double)totalSteps / games);
+  }
+
+  // Same seed and inputs must give the same game, bit for bit
+  GameResult first = playGame(MODE_NORMAL, 12345);
+  GameResult replay = playGame(MODE_NORMAL, 12345);
+  if (first.score != replay.score || first.steps != replay.steps || first.checksum != replay.checksum)
+  {
+    printf("replay diverged: score %d/%d, steps %lu/%lu\n", first.score, replay.score,
+           (unsigned long)first.steps, (unsigned long)replay.steps);
+    return 1;
+  }
+  printf("replay deterministic (checksum %08lx)\n", (unsigned long)first.checksum);
+
+  // Solid sprites against a tree and a duck that are only a two pixel wide stick, the easiest to tunnel through
+  static uint32_t solid[SLEIGH_HEIGHT];
+  static uint32_t stick[TREE_HEIGHT];
+  for (int y = 0; y < SLEIGH_HEIGHT; y++)
+  {
+    solid[y] = ~0u << (32 - SLEIGH_WIDTH);
+  }
+  for (int y = 0; y < TREE_HEIGHT; y++)
+  {
+    stick[y] = 3u << (32 - DUCK_WIDTH / 2);
+  }
+  static CollisionMasks masks;
+  masks.sleigh[0] = masks.sleigh[1] = {solid, SLEIGH_WIDTH, SLEIGH_HEIGHT};
+  masks.tree = {stick, TREE_WIDTH, TREE_HEIGHT};
+  for (int frame = 0; frame < MAX_CLIP_FRAMES; frame++)
+  {
+    masks.clips[CLIP_DUCK][frame] = {stick, DUCK_WIDTH, DUCK_HEIGHT};
+  }
+  if (!checkTunnelling(nullptr, maxCheatScore) || !checkTunnelling(&masks, maxCheatScore))
+  {
+    return 1;
+  }
+  printf("no tunnelling up to cheat score %d (%d px/step), with hitboxes and with masks\n", maxCheatScore,
+         FIXED_TO_INT(TO_FIXED(8) + maxCheatScore * (FIXED_ONE / 20)));
+  return 0;
+}
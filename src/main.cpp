@@ -9,61 +9,125 @@
 
 #include <TFT_eSPI.h>
 #include <SPI.h>
-#include <FS.h>
-#include <SPIFFS.h>
 #include <Preferences.h>
+#include <atomic>
+#include <GameCore.h>
+#include <SpriteAtlas.h>
 
 #ifndef ST7789_DRIVER
 #error "This code is intended to be used with the TTGO board. Please check your TFT_eSPI User_Setup.h make sure to uncomment User_Setups/Setup25_TTGO_T_Display.h"
 #endif
+#ifndef LOAD_GLCD
+#error "The score is drawn with TFT_eSPI's GLCD font: enable LOAD_GLCD in User_Setup.h"
+#endif
 // ============================================================================
 // CONSTANTS & CONFIGURATION
 // ============================================================================
+// Screen, object and gameplay constants live with the simulation in GameCore.h
 
-// Screen dimensions
-#define SCREEN_WIDTH 240
-#define SCREEN_HEIGHT 135
-#define GROUND_HEIGHT 10
-#define PLAYFIELD_HEIGHT (SCREEN_HEIGHT - GROUND_HEIGHT)
-
-// Game constants
+// Input
 #define BUTTON_PIN 12
 #define BUTTON2_PIN 26 // Optional second button for changing game mode
-#define GRAVITY 0.3
-#define JUMP_STRENGTH -4.0
-#define OBSTACLE_SPEED (gameData.gameMode == MODE_SPEED ? 8 : gameData.gameMode == MODE_CHEAT ? (8 + gameData.currentScore / 20) \
-                                                                                              : 2)
-#define OBSTACLE_SPAWN_DISTANCE 80
-#define OBSTACLE_SPAWN_OFFSET 40
-
-// Sleigh configuration
-#define SLEIGH_WIDTH 20
-#define SLEIGH_HEIGHT 14
-#define SLEIGH_HITBOX 8
-#define SLEIGH_START_X 40
-
-// Tree configuration
-#define TREE_WIDTH 20
-#define TREE_HEIGHT (SCREEN_HEIGHT / 4) // 34 pixels
-#define TREE_COUNT 5
-
-// Duck configuration
-#define DUCK_WIDTH 20
-#define DUCK_HEIGHT 14
-#define DUCK_HITBOX 10
-#define DUCK_COUNT 5
-#define DUCK_FLAP_INTERVAL 500 // milliseconds
-
-// Gift configuration
-#define GIFT_WIDTH 13
-#define GIFT_HEIGHT 14
-
-// Obstacle spawning configuration
-#define SPAWN_DELAY_MIN 800  // milliseconds
-#define SPAWN_DELAY_MAX 2500 // milliseconds
+#define BUTTON_COUNT 2
+#define DEBOUNCE_US 5000     // Edges closer than this to the last accepted one are bounce
+#define INPUT_QUEUE_SIZE 16  // Power of two
+
+// Frame pacing & threading
+#define SIM_STEP_US (SIM_STEP_MS * 1000)
+#define FRAME_US (1000000 / TARGET_FPS)
+#define MAX_CATCHUP_STEPS 5  // After a stall, simulate at most this many steps and drop the rest
+#define TARGET_FPS 60        // Render rate: 30, 50 or 60; rendering interpolates between steps
+#define DUAL_CORE 0          // 1 = simulation and rendering run as pinned tasks on separate cores
+#define SIM_CORE 0
+#define RENDER_CORE 1
+#if TARGET_FPS != 30 && TARGET_FPS != 50 && TARGET_FPS != 60
+#error "TARGET_FPS must be 30, 50 or 60"
+#endif
+
+// Menu animation
+#define MENU_WAVE_PERIOD 3142     // ms per bob of the menu sleigh (2 * pi * 500)
+#define MENU_FOE_WAVE_PERIOD 1257 // ms per bob of the menu foe (2 * pi * 200)
 
 // Snow effect
-#define MAX_SNOWFLAKES 50
+#define GAMEOVER_SNOWFLAKES 50 // Flakes piling up on the game over screen (POOL_SNOW)
+#define SNOW_ROW_WORDS ((SCREEN_WIDTH + 31) / 32) // A bit per column
+
+// Profiling
+#define PROFILER 0           // 1 = time each loop phase into histograms; 0 compiles every probe out
+#define PROFILER_HOLD_MS 2000 // Hold BUTTON2 this long (or send 'p' over Serial) to print the report
+#define PROFILER_BUCKETS 128
+
+// Particle effects (snow during play, explosion debris, gift sparkles)
+#define PARTICLE_CAPACITY 2048
+#define PARTICLE_FRAC_BITS 8 // Positions and velocities are fixed point with 8 fractional bits
+#define PARTICLE_ONE (1 << PARTICLE_FRAC_BITS)
+#define SNOW_POOL_SIZE 1024
+#define EXPLOSION_POOL_SIZE 512
+#define SPARKLE_POOL_SIZE (PARTICLE_CAPACITY - SNOW_POOL_SIZE - EXPLOSION_POOL_SIZE)
+#define GAMEPLAY_SNOWFLAKES 60
+#define EXPLOSION_PARTICLES 160
+#define SPARKLE_PARTICLES 40
+#define PARTICLE_STRIP_ROWS 4 // Direct paths: particles are redrawn in composed windows this many rows tall
+#define PARTICLE_STRIPS ((PLAYFIELD_HEIGHT + PARTICLE_STRIP_ROWS - 1) / PARTICLE_STRIP_ROWS)
+#define PARTICLE_STAGING_PIXELS (SCREEN_WIDTH * PARTICLE_STRIP_ROWS)
+#define PARTICLE_BENCHMARK 0 // 1 = time a full-capacity update + raster pass at boot and print particles/ms
+
+// Memory checks
+#define RESTART_HEAP_CHECK 0    // 1 = restart the game RESTART_CHECK_ROUNDS times at boot and print the heap before and after
+#define RESTART_CHECK_ROUNDS 1000
+
+// Rendering
+#define RENDER_DIRECT 0             // Clear and push each object straight to the panel
+#define RENDER_FRAMEBUFFER 1        // Compose the frame in RAM (~64 KB) and flush dirty rectangles
+#define RENDER_BANDS 2              // Compose BAND_HEIGHT-line bands in two small buffers pushed with DMA
+#define RENDER_QUEUED 3             // Direct drawing, staged into RAM windows queued as DMA transfers
+#define RENDER_MODE RENDER_DIRECT
+#define BAND_HEIGHT 16
+#define BAND_COUNT ((SCREEN_HEIGHT + BAND_HEIGHT - 1) / BAND_HEIGHT)
+#define QUEUE_STAGING_PIXELS (SCREEN_WIDTH * 8) // Per staging buffer; a larger window is drawn synchronously
+#define QUEUE_MAX_SPRITES 8                     // Sprites coalesced into one queued window
+#ifndef RENDER_STATS
+#define RENDER_STATS 0              // 1 = report SPI windows and bytes pushed per frame over Serial (esp32dev_debug env)
+#endif
+#define RENDER_STATS_INTERVAL 2000  // milliseconds between reports
+#define MAX_DIRTY_RECTS 32          // Rectangles tracked per frame before merging
+#define DIRTY_MERGE_SLACK 64        // Extra pixels accepted when merging two rects (cost of a window setup)
+#define SPRITES_PARTITION 0         // Map the atlas flashed to the sprites partition (swappable without a rebuild)
+#define SPRITES_EMBEDDED 1          // Compile the sheets into the firmware (embed_sprites.py): nothing to flash or load
+#ifndef SPRITE_SOURCE
+#define SPRITE_SOURCE SPRITES_PARTITION // The esp32dev_embedded env builds with SPRITES_EMBEDDED
+#endif
+#define SCORE_WIDTH 100
+#define SCORE_HEIGHT 16
+#define SCORE_X 5
+#define SCORE_TEXT_Y 2       // Text row within the score buffer
+#define GLYPH_WIDTH 5        // GLCD font: 5x8 glyphs in 6 pixel cells
+#define GLYPH_ADVANCE 6
+#define DRAW_SLOTS (ENTITY_COUNT + 1) // Entity slots (trees, then flying obstacles), then the sleigh
+#define SLEIGH_SLOT (DRAW_SLOTS - 1)
+
+// Pixel arena: one static block holding every RAM pixel buffer, carved up in setup()
+#define PIXEL_ARENA_BUDGET (96 * 1024) // Bytes; checked at compile time against the buffers below
+#ifndef ARENA_REPORT
+#define ARENA_REPORT 0                 // 1 = print what each asset took from the arena at boot (esp32dev_debug env)
+#endif
+#define ARENA_MAX_ASSETS 16
+#define FALLBACK_SPRITE_PIXELS (4 * SLEIGH_WIDTH * SLEIGH_HEIGHT + 4 * DUCK_WIDTH * DUCK_HEIGHT + \
+                                GIFT_WIDTH * GIFT_HEIGHT + TREE_WIDTH * TREE_HEIGHT) // Every sprite drawn procedurally
+#define FALLBACK_MASK_ROWS (4 * SLEIGH_HEIGHT + 4 * DUCK_HEIGHT + GIFT_HEIGHT + TREE_HEIGHT) // And their collision masks
+#if RENDER_MODE == RENDER_FRAMEBUFFER
+#define RENDER_BUFFER_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+#elif RENDER_MODE == RENDER_BANDS
+#define RENDER_BUFFER_PIXELS (2 * SCREEN_WIDTH * BAND_HEIGHT)
+#elif RENDER_MODE == RENDER_QUEUED
+#define RENDER_BUFFER_PIXELS (2 * QUEUE_STAGING_PIXELS)
+#else
+#define RENDER_BUFFER_PIXELS 0
+#endif
+// One pixel of padding per asset keeps every block 4-byte aligned for DMA
+#define PIXEL_ARENA_PIXELS (FALLBACK_SPRITE_PIXELS + SCORE_WIDTH * SCORE_HEIGHT + PARTICLE_STAGING_PIXELS + \
+                            RENDER_BUFFER_PIXELS + ARENA_MAX_ASSETS)
+static_assert(PIXEL_ARENA_PIXELS * sizeof(uint16_t) <= PIXEL_ARENA_BUDGET, "pixel buffers exceed PIXEL_ARENA_BUDGET");
 
 // Colors
 #define SKY_BLUE 0x3A9F
@@ -74,121 +138,434 @@
 #define DUCK_YELLOW 0xFFE0
 #define WHITE 0xFFFF
 
+// Sprite buffers hold RGB565 in the panel's byte order (high byte first)
+#define PANEL_COLOR(c) ((uint16_t)(((c) >> 8) | ((c) << 8)))
+
 // ============================================================================
 // ENUMS & STRUCTURES
 // ============================================================================
 
-enum GameState
+// Debounced button edge, timestamped in the ISR
+struct InputEvent
+{
+  uint32_t timestamp; // micros()
+  uint8_t button;     // 0 = BUTTON_PIN, 1 = BUTTON2_PIN
+  bool pressed;
+};
+
+// Lock-free single-producer/single-consumer ring of input events. Producers (the
+// GPIO ISRs and reconcileButtons) are serialised by inputMux, so they act as one;
+// the simulation is the consumer.
+struct InputQueue
+{
+  InputEvent events[INPUT_QUEUE_SIZE];
+  std::atomic<uint8_t> head{0}; // Next slot the producer writes
+  std::atomic<uint8_t> tail{0}; // Next slot the consumer reads
+
+  // Drops the event when full
+  bool push(const InputEvent &event)
+  {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    if ((uint8_t)(h - tail.load(std::memory_order_acquire)) == INPUT_QUEUE_SIZE)
+    {
+      return false;
+    }
+    events[h % INPUT_QUEUE_SIZE] = event;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool peek(InputEvent &event)
+  {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    event = events[t % INPUT_QUEUE_SIZE];
+    return true;
+  }
+
+  void pop()
+  {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+};
+
+// Debounce state of one button, owned by its ISR
+struct ButtonState
+{
+  uint8_t pin;
+  volatile bool down;
+  volatile uint32_t lastEdge;
+};
+
+enum ParticlePoolId
+{
+  POOL_SNOW,
+  POOL_EXPLOSION,
+  POOL_SPARKLE,
+  POOL_COUNT
+};
+
+// A contiguous slice of the particle arrays owned by one emitter; live particles are packed at the front
+struct ParticlePool
+{
+  uint16_t first;
+  uint16_t capacity;
+  uint16_t count;
+  int16_t gravity; // Added to vy every frame (fixed point)
+  bool ageing;     // Whether life counts down (snow lives until it leaves the playfield)
+};
+
+// Structure-of-arrays particle storage so each update pass streams through tight arrays
+struct Particles
+{
+  int32_t x[PARTICLE_CAPACITY]; // Fixed point, PARTICLE_FRAC_BITS
+  int32_t y[PARTICLE_CAPACITY];
+  int16_t vx[PARTICLE_CAPACITY];
+  int16_t vy[PARTICLE_CAPACITY];
+  uint16_t color[PARTICLE_CAPACITY];
+  uint8_t life[PARTICLE_CAPACITY]; // Frames left
+  ParticlePool pools[POOL_COUNT];
+};
+
+// Screen-space rectangle used for dirty-region tracking
+struct Rect
 {
-  STATE_MENU,     // Waiting for player to start
-  STATE_PLAYING,  // Active gameplay
-  STATE_GAME_OVER // Game ended, showing results
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+
+  int area() const
+  {
+    return w * h;
+  }
+
+  bool clip()
+  {
+    if (x < 0)
+    {
+      w += x;
+      x = 0;
+    }
+    if (y < 0)
+    {
+      h += y;
+      y = 0;
+    }
+    if (x + w > SCREEN_WIDTH)
+      w = SCREEN_WIDTH - x;
+    if (y + h > SCREEN_HEIGHT)
+      h = SCREEN_HEIGHT - y;
+    return w > 0 && h > 0;
+  }
+
+  Rect unionWith(const Rect &other) const
+  {
+    int left = x < other.x ? x : other.x;
+    int top = y < other.y ? y : other.y;
+    int right = x + w > other.x + other.w ? x + w : other.x + other.w;
+    int bottom = y + h > other.y + other.h ? y + h : other.y + other.h;
+    return {(int16_t)left, (int16_t)top, (int16_t)(right - left), (int16_t)(bottom - top)};
+  }
 };
 
-enum GameMode
+// Set of screen regions that changed this frame
+struct DirtyList
 {
-  MODE_NORMAL,
-  MODE_SPEED,
-  MODE_CHEAT,
+  Rect rects[MAX_DIRTY_RECTS];
+  int count;
+
+  void clear()
+  {
+    count = 0;
+  }
+
+  void add(int x, int y, int w, int h)
+  {
+    Rect r = {(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h};
+    if (!r.clip())
+    {
+      return;
+    }
+    if (count == MAX_DIRTY_RECTS)
+    {
+      // Out of slots: grow the last rect rather than dropping damage
+      rects[count - 1] = rects[count - 1].unionWith(r);
+      return;
+    }
+    rects[count++] = r;
+  }
+
+  // Greedily merge rect pairs while the merged window costs less than two separate ones
+  void merge()
+  {
+    bool merged = true;
+    while (merged)
+    {
+      merged = false;
+      for (int i = 0; i < count && !merged; i++)
+      {
+        for (int j = i + 1; j < count; j++)
+        {
+          Rect u = rects[i].unionWith(rects[j]);
+          if (u.area() <= rects[i].area() + rects[j].area() + DIRTY_MERGE_SLACK)
+          {
+            rects[i] = u;
+            rects[j] = rects[--count];
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+  }
 };
-enum ObstacleType
+
+// What one asset took from the pixel arena, for the boot report
+struct ArenaAsset
 {
-  TYPE_DUCK, // Collision = game over
-  TYPE_FOE,  // Hit from above = 20 points, hit while flapping = -10 points + game over
-  TYPE_GIFT  // Hit = 10 points, disappears
+  const char *name;
+  uint32_t pixels;
 };
 
-// Position structure for 2D objects
-struct Position
+// Bump allocator over one static block. Every RAM pixel buffer is carved from it
+// once in setup() and never freed, so no pixel memory comes from the heap.
+struct PixelArena
 {
-  int x;
-  int y;
-  int oldX;
-  int oldY;
+  alignas(4) uint16_t pixels[PIXEL_ARENA_PIXELS];
+  uint32_t used; // Pixels handed out
+  ArenaAsset assets[ARENA_MAX_ASSETS];
+  int assetCount;
 
-  void updateOld()
+  // nullptr when the block does not fit; PIXEL_ARENA_PIXELS is sized so that never happens
+  uint16_t *allocate(uint32_t count, const char *name)
   {
-    oldX = x;
-    oldY = y;
+    count = (count + 1) & ~1u; // Keep the next block 4-byte aligned
+    if (used + count > PIXEL_ARENA_PIXELS || assetCount == ARENA_MAX_ASSETS)
+    {
+      return nullptr;
+    }
+    uint16_t *block = pixels + used;
+    used += count;
+    assets[assetCount++] = {name, count};
+    return block;
   }
+};
 
-  void move(int dx, int dy = 0)
+// Game sprites, by atlas frame (the flying obstacles are animation clips instead)
+enum SpriteId
+{
+  SPRITE_SLEIGH0,
+  SPRITE_SLEIGH1,
+  SPRITE_EXPLOSION0,
+  SPRITE_EXPLOSION1,
+  SPRITE_TREE,
+  SPRITE_COUNT
+};
+
+// A sprite found in the atlas by frame name, with the size the game lays it out at
+// and its procedural fallback
+struct SpriteSlot
+{
+  const char *name;
+  SpriteId id;
+  int16_t width;
+  int16_t height;
+  void (*createDefault)(TFT_eSprite &sprite);
+};
+
+// An animation clip made of the frames <name>0, <name>1, ... in the sprite source,
+// as many as there are in a row, with procedural frames when there are none
+struct ClipSlot
+{
+  const char *name;
+  ClipId clip;
+  int16_t width; // Of every frame
+  int16_t height;
+  void (*createDefault[2])(TFT_eSprite &sprite); // nullptr for a one-frame fallback
+};
+
+// A clip's frames and how long each shows (ms), as loaded from the sprite source
+struct Animation
+{
+  SpriteImage frames[MAX_CLIP_FRAMES];
+  uint16_t durations[MAX_CLIP_FRAMES];
+  uint8_t count;
+
+  // Frame for a cursor from the game core
+  const SpriteImage &frame(int index) const
   {
-    updateOld();
-    x += dx;
-    y += dy;
+    return frames[index < count ? index : 0];
   }
 };
 
-struct Tree
+// Recolouring applied to indexed sprites as they are expanded, by swapping their palette
+enum PaletteEffect
+{
+  PALETTE_NORMAL,
+  PALETTE_CRASH // Red tint while the sleigh crashes or explodes
+};
+
+// One sprite placed on screen for the composing renderers
+struct DrawItem
+{
+  const SpriteImage *sprite;
+  int16_t x;
+  int16_t y;
+};
+
+enum ProfilePhase
+{
+  PHASE_INPUT,
+  PHASE_PHYSICS,
+  PHASE_OBSTACLES,
+  PHASE_ANIMATION,
+  PHASE_COLLISIONS,
+  PHASE_SCORE,
+  PHASE_DRAW,
+  PHASE_COUNT
+};
+
+// Log-linear histogram of phase durations in microseconds: exact below 8 us,
+// then 8 buckets per power of two (12.5% resolution)
+struct PhaseHistogram
 {
-  Position pos;
-  bool active;         // Whether this obstacle is currently in play
-  uint32_t spawnTimer; // Timer for spawn delay
-  bool scored;
-  TFT_eSprite *sprite;
+  uint32_t buckets[PROFILER_BUCKETS];
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+
+  static int bucketFor(uint32_t us)
+  {
+    if (us < 8)
+    {
+      return us;
+    }
+    int msb = 31 - __builtin_clz(us);
+    int index = 8 + (msb - 3) * 8 + ((us >> (msb - 3)) & 7);
+    return index < PROFILER_BUCKETS ? index : PROFILER_BUCKETS - 1;
+  }
+
+  // Smallest duration that falls in a bucket
+  static uint32_t bucketFloor(int index)
+  {
+    if (index < 8)
+    {
+      return index;
+    }
+    int msb = (index - 8) / 8 + 3;
+    return (uint32_t)(8 + (index - 8) % 8) << (msb - 3);
+  }
+
+  void record(uint32_t us)
+  {
+    buckets[bucketFor(us)]++;
+    if (count == 0 || us < min)
+      min = us;
+    if (us > max)
+      max = us;
+    total += us;
+    count++;
+  }
+
+  uint32_t percentile(int percent) const
+  {
+    uint32_t target = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < PROFILER_BUCKETS; i++)
+    {
+      seen += buckets[i];
+      if (seen >= target)
+      {
+        return bucketFloor(i);
+      }
+    }
+    return max;
+  }
 };
 
-struct FlyingObstacle
+// SPI traffic counters for the gameplay renderer
+struct RenderStats
 {
-  Position pos;
-  bool active;         // Whether this obstacle is currently in play
-  uint32_t spawnTimer; // Timer for spawn delay
-  bool scored;
-  ObstacleType type; // Type of obstacle
+  uint32_t frames;
+  uint32_t windows;
+  uint32_t bytes;
+  uint32_t spiWaitMicros; // CPU time blocked on DMA transfers and the queued path's synchronous pushes (DMA modes)
+  uint32_t lastReport;
+};
 
-  // Animation state
-  uint32_t lastFlap; // Last time this obstacle flapped (for ducks/foes)
-  bool flapFrame;    // Current frame (0 or 1)
+// A sprite placed in a queued window; held by value, since the score sprite is a temporary
+struct QueuedSprite
+{
+  SpriteImage image;
+  int16_t x;
+  int16_t y;
+};
 
-  // Falling state (for killed foes)
-  bool falling;       // Whether foe is falling after being killed
-  float fallVelocity; // Falling speed
+// RENDER_QUEUED transport: draws collect into a pending window, which is composed into a
+// staging buffer and handed to DMA when the next draw cannot extend it. One transfer runs
+// while the next window is composed, and the last one of a frame runs while the game goes on.
+struct DisplayQueue
+{
+  uint16_t *staging[2]; // Ping-pong, from the arena
+  int current;
+  Rect window; // Pending, not yet composed; w == 0 when empty. Sky wherever no sprite covers it.
+  QueuedSprite sprites[QUEUE_MAX_SPRITES];
+  int spriteCount;
+  bool writing; // A transfer may be in flight: the panel is held with startWrite
 };
 
-struct SnowFlake
+// A published simulation state, stamped for the renderer's interpolation
+struct Snapshot
 {
-  int x;
-  int y;
-  bool active;
+  GameData game;
+  uint32_t stepMicros; // micros() when the step ran
 };
 
-// Unified game state structure
-struct GameData
-{
-  // Game state
-  GameState state;
-  uint32_t lastStateChange;
-
-  // Player physics
-  float sleighY;
-  float sleighVelocity;
-  float sleighOldY;
-  bool sleighCrashed;          // Whether sleigh has crashed and is falling to ground
-  uint32_t crashingStartTime;  // When crashing animation started
-  bool sleighExploding;        // Whether sleigh is exploding (1 second animation)
-  uint32_t explosionStartTime; // When explosion animation started
-
-  GameMode gameMode; // Current game mode
-
-  // Score & high scores
-  int currentScore;
-  int sessionHighScore[MODE_CHEAT + 1];
-  int foreverHighScore[MODE_CHEAT + 1];
-
-  // Input
-  bool buttonPressed;
-
-  // Animation & rendering
-  uint32_t lastDuckFlap;
-  bool duckFrame;
-  bool gameOverScreenDrawn;
-  bool highScoreUpdated;
-
-  // Obstacles
-  Tree trees[TREE_COUNT];
-  FlyingObstacle flyingObstacles[DUCK_COUNT];
-  SnowFlake snowflakes[MAX_SNOWFLAKES];
+// Lock-free single-producer/single-consumer triple buffer of game snapshots.
+// The simulation owns one slot and the renderer another; the third is handed over
+// with an atomic exchange, so neither side ever waits for the other and the
+// renderer always gets the latest complete state.
+struct SnapshotBuffer
+{
+  static const uint8_t INDEX_MASK = 0x3;
+  static const uint8_t FRESH = 0x4; // Set on the shared slot when it holds an unread snapshot
+
+  Snapshot slots[3];
+  std::atomic<uint8_t> shared{1};
+  uint8_t writeIndex = 0;
+  uint8_t readIndex = 2;
+
+  Snapshot &writeSlot()
+  {
+    return slots[writeIndex];
+  }
+
+  // Hand the write slot over to the renderer and take back the shared one
+  void publish()
+  {
+    writeIndex = shared.exchange(writeIndex | FRESH) & INDEX_MASK;
+  }
+
+  // Swap in the newest snapshot; false if nothing was published since the last call
+  bool acquire()
+  {
+    if (!(shared.load() & FRESH))
+    {
+      return false;
+    }
+    readIndex = shared.exchange(readIndex) & INDEX_MASK;
+    return true;
+  }
+
+  const Snapshot &readSlot() const
+  {
+    return slots[readIndex];
+  }
 };
 
 // ============================================================================
@@ -199,430 +576,869 @@ TFT_eSPI tft = TFT_eSPI();
 Preferences preferences;
 
 // Sprites
-TFT_eSprite sleighSprite = TFT_eSprite(&tft);
-TFT_eSprite sleighSprite2 = TFT_eSprite(&tft);
-TFT_eSprite duckSprite = TFT_eSprite(&tft);
-TFT_eSprite duckSprite2 = TFT_eSprite(&tft);
-TFT_eSprite foeSprite = TFT_eSprite(&tft);
-TFT_eSprite foeSprite2 = TFT_eSprite(&tft);
-TFT_eSprite giftSprite = TFT_eSprite(&tft);
-TFT_eSprite explosionSprite = TFT_eSprite(&tft);
-TFT_eSprite explosionSprite2 = TFT_eSprite(&tft);
-TFT_eSprite scoreSprite = TFT_eSprite(&tft);
+SpriteAtlas spriteAtlas;           // Mapped for the whole run: sprites point into it
+SpriteImage sprites[SPRITE_COUNT]; // Registry loaded once at boot and shared by every object of a kind: views into
+                                   // flash, or into RAM canvases for procedural fallbacks. Restarts never touch it.
+Animation animations[CLIP_COUNT];  // Obstacle clips, loaded alongside the sprites
+CollisionMasks collisionMasks;     // The sprites' masks, handed to the game core
+uint32_t fallbackMasks[FALLBACK_MASK_ROWS]; // Masks of the procedural sprites, which have none in flash
+int fallbackMaskRows = 0;
+bool spritesLoaded = false;
+PixelArena pixelArena;
+uint16_t *scoreBuffer = nullptr; // SCORE_WIDTH x SCORE_HEIGHT, from the arena
+
+// Composing renderers (RENDER_FRAMEBUFFER / RENDER_BANDS)
+int renderMode = RENDER_DIRECT; // Falls back to direct if the configured mode cannot start
+bool renderFullFlush = true;
+DirtyList previousRects; // Object rects drawn last frame
+DirtyList dirtyRects;
+uint16_t *frameBuffer = nullptr; // SCREEN_WIDTH x SCREEN_HEIGHT, from the arena
+#if RENDER_MODE == RENDER_BANDS
+uint16_t *bandBuffers[2]; // Ping-pong, from the arena: compose one while DMA sends the other
+#elif RENDER_MODE == RENDER_QUEUED
+DisplayQueue displayQueue;
+#endif
+int lastFlushedScore = -1;
+RenderStats renderStats;
+#if PROFILER
+PhaseHistogram phaseHistograms[PHASE_COUNT];
+uint32_t profilerHoldStart = 0;
+#if DUAL_CORE
+std::atomic<uint8_t> profileRequests{0}; // PROFILE_* bits the render core still has to serve
+#endif
+#endif
 
 // Game state
 GameData gameData;
 
+// Input
+InputQueue inputQueue;
+uint8_t buttonsDown = 0; // Bit per button currently held, as seen by the simulation
+ButtonState buttons[BUTTON_COUNT] = {{BUTTON_PIN, false, 0}, {BUTTON2_PIN, false, 0}};
+portMUX_TYPE inputMux = portMUX_INITIALIZER_UNLOCKED;
+#if DUAL_CORE
+SnapshotBuffer snapshots;
+#else
+uint32_t simAccumulator = 0; // Microseconds of real time not yet simulated
+uint32_t lastTickMicros = 0;
+#endif
+
+// Render-side state (only touched by the renderer)
+GameState renderedState = STATE_MENU;
+uint32_t renderedSimTime = 0; // Simulation time effects have been advanced to
+DrawItem frameItems[DRAW_SLOTS]; // What the last gameplay frame put on the panel
+Rect drawnSlots[DRAW_SLOTS];      // Direct path: rect each slot occupies on the panel
+uint32_t snowOccupancy[SCREEN_HEIGHT][SNOW_ROW_WORDS]; // 1 = pixel is not sky, so snow cannot fall into it
+int16_t snowSurface[SCREEN_WIDTH];                     // Topmost occupied row per column
+Particles particles;
+uint32_t particleSeed = 0x9E3779B9;
+uint16_t renderedGifts = 0;    // giftsCollected already turned into sparkles
+bool renderedExploding = false;
+Rect particleBounds;           // Composing paths: area the particles covered last frame
+uint32_t particleDamage[PARTICLE_STRIPS][SNOW_ROW_WORDS]; // Direct paths: columns with particles, last frame or now
+uint16_t *particleStaging = nullptr;                      // Direct paths: PARTICLE_STAGING_PIXELS, from the arena
+PaletteEffect paletteEffect = PALETTE_NORMAL;
+
+// ============================================================================
+// PROFILING
+// ============================================================================
+
+#if PROFILER
+// Run a call and record its duration under a phase, using the CPU cycle counter
+#define PROFILED(phase, call)                                                      \
+  do                                                                               \
+  {                                                                                \
+    uint32_t profileStart = ESP.getCycleCount();                                   \
+    call;                                                                          \
+    uint32_t profileCycles = ESP.getCycleCount() - profileStart;                   \
+    phaseHistograms[phase].record(profileCycles / getCpuFrequencyMhz());           \
+  } while (0)
+
+// Phases the simulation core times; with DUAL_CORE the rest are timed on the render core,
+// and only that core reads or resets their histograms
+const int SIM_PHASES = DUAL_CORE ? PHASE_DRAW : PHASE_COUNT;
+
+enum ProfileRequest : uint8_t
+{
+  PROFILE_PRINT = 1,
+  PROFILE_RESET = 2
+};
+
+void printPhases(int first, int last)
+{
+  static const char *names[PHASE_COUNT] = {"input", "physics", "obstacles", "animation", "collisions", "score", "draw"};
+  for (int phase = first; phase < last; phase++)
+  {
+    const PhaseHistogram &h = phaseHistograms[phase];
+    Serial.printf("%-10s %7lu %6lu %6lu %6lu %6lu %6lu\n", names[phase], (unsigned long)h.count,
+                  (unsigned long)h.min, (unsigned long)(h.count ? h.total / h.count : 0),
+                  (unsigned long)h.percentile(95), (unsigned long)h.percentile(99), (unsigned long)h.max);
+  }
+}
+
+void resetPhases(int first, int last)
+{
+  memset(&phaseHistograms[first], 0, (last - first) * sizeof(PhaseHistogram));
+}
+
+// Simulation core: report its own phases and ask the render core for the rest
+void printProfile()
+{
+  Serial.println("phase        count    min   mean    p95    p99    max  (us)");
+  printPhases(0, SIM_PHASES);
+#if DUAL_CORE
+  profileRequests.fetch_or(PROFILE_PRINT);
+#endif
+}
+
+void resetProfile()
+{
+  resetPhases(0, SIM_PHASES);
+#if DUAL_CORE
+  profileRequests.fetch_or(PROFILE_RESET);
+#endif
+}
+
+#if DUAL_CORE
+// Render core: serve pending requests for the phases it times, between frames
+void pollRenderProfiler()
+{
+  uint8_t requests = profileRequests.exchange(0);
+  if (requests & PROFILE_PRINT)
+  {
+    printPhases(SIM_PHASES, PHASE_COUNT);
+  }
+  if (requests & PROFILE_RESET)
+  {
+    resetPhases(SIM_PHASES, PHASE_COUNT);
+  }
+}
+#endif
+
+// Print the report on 'p' over Serial or after BUTTON2 is held, reset it on 'r'
+void pollProfiler()
+{
+  while (Serial.available())
+  {
+    int command = Serial.read();
+    if (command == 'p')
+    {
+      printProfile();
+    }
+    else if (command == 'r')
+    {
+      resetProfile();
+    }
+  }
+
+  if (digitalRead(BUTTON2_PIN))
+  {
+    profilerHoldStart = 0;
+  }
+  else if (profilerHoldStart == 0)
+  {
+    profilerHoldStart = millis();
+  }
+  else if (millis() - profilerHoldStart >= PROFILER_HOLD_MS)
+  {
+    printProfile();
+    profilerHoldStart = millis(); // Repeat while still held
+  }
+}
+#else
+#define PROFILED(phase, call) call
+#endif
+
 // ============================================================================
 // SPRITE CREATION
 // ============================================================================
 
-void createDefaultSleigh()
+void createDefaultSleigh(TFT_eSprite &sprite)
 {
-  sleighSprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-  sleighSprite.fillSprite(SKY_BLUE);
-  sleighSprite.fillRect(2, 2, SLEIGH_WIDTH - 4, SLEIGH_HEIGHT - 4, SLEIGH_RED);
-  sleighSprite.drawLine(0, SLEIGH_HEIGHT - 1, SLEIGH_WIDTH, SLEIGH_HEIGHT - 1, SLEIGH_RED);
-  sleighSprite.fillRect(4, 0, 6, 4, TFT_GREEN);
+  sprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
+  sprite.fillRect(2, 2, SLEIGH_WIDTH - 4, SLEIGH_HEIGHT - 4, SLEIGH_RED);
+  sprite.drawLine(0, SLEIGH_HEIGHT - 1, SLEIGH_WIDTH, SLEIGH_HEIGHT - 1, SLEIGH_RED);
+  sprite.fillRect(4, 0, 6, 4, TFT_GREEN);
 }
 
-void createDefaultSleigh2()
+void createDefaultSleigh2(TFT_eSprite &sprite)
 {
-  sleighSprite2.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-  sleighSprite2.fillSprite(SKY_BLUE);
-  sleighSprite2.fillRect(2, 2, SLEIGH_WIDTH - 4, SLEIGH_HEIGHT - 4, SLEIGH_RED);
-  sleighSprite2.drawLine(0, SLEIGH_HEIGHT - 1, SLEIGH_WIDTH, SLEIGH_HEIGHT - 1, SLEIGH_RED);
-  sleighSprite2.fillRect(4, 0, 6, 4, TFT_GREEN);
+  sprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
+  sprite.fillRect(2, 2, SLEIGH_WIDTH - 4, SLEIGH_HEIGHT - 4, SLEIGH_RED);
+  sprite.drawLine(0, SLEIGH_HEIGHT - 1, SLEIGH_WIDTH, SLEIGH_HEIGHT - 1, SLEIGH_RED);
+  sprite.fillRect(4, 0, 6, 4, TFT_GREEN);
 }
 
-void createDefaultDuck()
+void createDefaultDuck(TFT_eSprite &sprite)
 {
-  duckSprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-  duckSprite.fillSprite(SKY_BLUE);
-  duckSprite.fillCircle(6, 7, 5, DUCK_YELLOW);
-  duckSprite.fillCircle(12, 5, 4, DUCK_YELLOW);
-  duckSprite.fillTriangle(15, 5, 19, 4, 19, 6, TFT_ORANGE);
-  duckSprite.fillCircle(13, 4, 1, TFT_BLACK);
+  sprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
+  sprite.fillCircle(6, 7, 5, DUCK_YELLOW);
+  sprite.fillCircle(12, 5, 4, DUCK_YELLOW);
+  sprite.fillTriangle(15, 5, 19, 4, 19, 6, TFT_ORANGE);
+  sprite.fillCircle(13, 4, 1, TFT_BLACK);
 }
 
-void createDefaultDuck2()
+void createDefaultDuck2(TFT_eSprite &sprite)
 {
-  duckSprite2.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-  duckSprite2.fillSprite(SKY_BLUE);
-  duckSprite2.fillCircle(6, 8, 5, DUCK_YELLOW);
-  duckSprite2.fillCircle(12, 4, 4, DUCK_YELLOW);
-  duckSprite2.fillTriangle(15, 4, 19, 3, 19, 5, TFT_ORANGE);
-  duckSprite2.fillCircle(13, 3, 1, TFT_BLACK);
+  sprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
+  sprite.fillCircle(6, 8, 5, DUCK_YELLOW);
+  sprite.fillCircle(12, 4, 4, DUCK_YELLOW);
+  sprite.fillTriangle(15, 4, 19, 3, 19, 5, TFT_ORANGE);
+  sprite.fillCircle(13, 3, 1, TFT_BLACK);
 }
 
-void createDefaultFoe()
+void createDefaultFoe(TFT_eSprite &sprite)
 {
-  foeSprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-  foeSprite.fillSprite(SKY_BLUE);
+  sprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
   // Black Peter - dark figure
-  foeSprite.fillCircle(10, 7, 6, TFT_BLACK);
-  foeSprite.fillCircle(8, 5, 2, TFT_RED);
-  foeSprite.fillRect(6, 10, 8, 3, TFT_BLACK);
+  sprite.fillCircle(10, 7, 6, TFT_BLACK);
+  sprite.fillCircle(8, 5, 2, TFT_RED);
+  sprite.fillRect(6, 10, 8, 3, TFT_BLACK);
 }
 
-void createDefaultFoe2()
+void createDefaultFoe2(TFT_eSprite &sprite)
 {
-  foeSprite2.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-  foeSprite2.fillSprite(SKY_BLUE);
+  sprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
   // Black Peter - dark figure (flapping)
-  foeSprite2.fillCircle(10, 7, 6, TFT_BLACK);
-  foeSprite2.fillCircle(8, 5, 2, TFT_RED);
-  foeSprite2.fillRect(5, 9, 10, 3, TFT_BLACK);
+  sprite.fillCircle(10, 7, 6, TFT_BLACK);
+  sprite.fillCircle(8, 5, 2, TFT_RED);
+  sprite.fillRect(5, 9, 10, 3, TFT_BLACK);
 }
 
-void createDefaultGift()
+void createDefaultGift(TFT_eSprite &sprite)
 {
-  giftSprite.createSprite(GIFT_WIDTH, GIFT_HEIGHT);
-  giftSprite.fillSprite(SKY_BLUE);
+  sprite.createSprite(GIFT_WIDTH, GIFT_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
   // Gift box - colorful present
-  giftSprite.fillRect(5, 4, 10, 8, TFT_RED);
-  giftSprite.fillRect(9, 3, 2, 10, TFT_YELLOW);
-  giftSprite.fillRect(4, 7, 12, 2, TFT_YELLOW);
-  giftSprite.fillCircle(10, 5, 2, TFT_YELLOW);
+  sprite.fillRect(5, 4, 10, 8, TFT_RED);
+  sprite.fillRect(9, 3, 2, 10, TFT_YELLOW);
+  sprite.fillRect(4, 7, 12, 2, TFT_YELLOW);
+  sprite.fillCircle(10, 5, 2, TFT_YELLOW);
 }
 
-void createDefaultExplosion()
+void createDefaultExplosion(TFT_eSprite &sprite)
 {
-  explosionSprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-  explosionSprite.fillSprite(SKY_BLUE);
+  sprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
   // Explosion effect - jagged red/orange/yellow
-  explosionSprite.fillCircle(10, 7, 8, TFT_RED);
-  explosionSprite.fillCircle(10, 7, 5, TFT_ORANGE);
-  explosionSprite.fillCircle(10, 7, 2, TFT_YELLOW);
+  sprite.fillCircle(10, 7, 8, TFT_RED);
+  sprite.fillCircle(10, 7, 5, TFT_ORANGE);
+  sprite.fillCircle(10, 7, 2, TFT_YELLOW);
   // Add some spiky points
-  explosionSprite.fillTriangle(10, 0, 8, 4, 12, 4, TFT_ORANGE);
-  explosionSprite.fillTriangle(18, 7, 14, 6, 14, 8, TFT_ORANGE);
-  explosionSprite.fillTriangle(2, 7, 6, 6, 6, 8, TFT_ORANGE);
-  explosionSprite.fillTriangle(10, 14, 8, 10, 12, 10, TFT_ORANGE);
+  sprite.fillTriangle(10, 0, 8, 4, 12, 4, TFT_ORANGE);
+  sprite.fillTriangle(18, 7, 14, 6, 14, 8, TFT_ORANGE);
+  sprite.fillTriangle(2, 7, 6, 6, 6, 8, TFT_ORANGE);
+  sprite.fillTriangle(10, 14, 8, 10, 12, 10, TFT_ORANGE);
 }
 
-void createDefaultExplosion2()
+void createDefaultExplosion2(TFT_eSprite &sprite)
 {
-  explosionSprite2.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-  explosionSprite2.fillSprite(SKY_BLUE);
+  sprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
   // Explosion effect - larger burst with different spike positions
-  explosionSprite2.fillCircle(10, 7, 7, TFT_ORANGE);
-  explosionSprite2.fillCircle(10, 7, 4, TFT_YELLOW);
-  explosionSprite2.fillCircle(10, 7, 1, TFT_WHITE);
+  sprite.fillCircle(10, 7, 7, TFT_ORANGE);
+  sprite.fillCircle(10, 7, 4, TFT_YELLOW);
+  sprite.fillCircle(10, 7, 1, TFT_WHITE);
   // Add spiky points at different angles
-  explosionSprite2.fillTriangle(10, 1, 7, 5, 13, 5, TFT_RED);
-  explosionSprite2.fillTriangle(17, 7, 13, 5, 13, 9, TFT_RED);
-  explosionSprite2.fillTriangle(3, 7, 7, 5, 7, 9, TFT_RED);
-  explosionSprite2.fillTriangle(10, 13, 7, 9, 13, 9, TFT_RED);
+  sprite.fillTriangle(10, 1, 7, 5, 13, 5, TFT_RED);
+  sprite.fillTriangle(17, 7, 13, 5, 13, 9, TFT_RED);
+  sprite.fillTriangle(3, 7, 7, 5, 7, 9, TFT_RED);
+  sprite.fillTriangle(10, 13, 7, 9, 13, 9, TFT_RED);
 }
 
-void createTreeSprite(int treeIndex)
+void createDefaultTree(TFT_eSprite &sprite)
 {
-  if (gameData.trees[treeIndex].sprite != nullptr)
-  {
-    gameData.trees[treeIndex].sprite->deleteSprite();
-    delete gameData.trees[treeIndex].sprite;
+  sprite.createSprite(TREE_WIDTH, TREE_HEIGHT);
+  sprite.fillSprite(SKY_BLUE);
+
+  int trunkWidth = 6;
+  int trunkHeight = TREE_HEIGHT / 4;
+  sprite.fillRect(
+      TREE_WIDTH / 2 - trunkWidth / 2, TREE_HEIGHT - trunkHeight,
+      trunkWidth, trunkHeight, TREE_BROWN);
+
+  for (int i = 0; i < 3; i++)
+  {
+    int layerHeight = (TREE_HEIGHT - trunkHeight) / 3;
+    int layerWidth = TREE_WIDTH - i * 4;
+    int layerY = trunkHeight + i * layerHeight;
+    sprite.fillTriangle(
+        TREE_WIDTH / 2, layerY,
+        TREE_WIDTH / 2 - layerWidth / 2, layerY + layerHeight,
+        TREE_WIDTH / 2 + layerWidth / 2, layerY + layerHeight,
+        TREE_GREEN);
   }
+}
+
+#if SPRITE_SOURCE == SPRITES_EMBEDDED
+#include <embedded_sprites.h> // Generated into the build directory by embed_sprites.py
+static_assert(EMBEDDED_SPRITES_VERSION == ATLAS_VERSION, "embedded_sprites.h is out of date; rebuild to regenerate it");
 
-  gameData.trees[treeIndex].sprite = new TFT_eSprite(&tft);
+int spriteCount()
+{
+  return EMBEDDED_SPRITE_COUNT;
+}
+
+// Point an image at frame index of the firmware's own sprites, read straight from flash.
+// Returns the frame's name; duration is its animation timing (0 = default).
+const char *spriteFrame(int index, SpriteImage &image, uint16_t &duration)
+{
+  const EmbeddedSprite &sprite = embeddedSprites[index];
+  int16_t stride = sprite.format == ATLAS_FORMAT_INDEXED4 ? (sprite.width + 1) / 2 : sprite.width;
+  image = {sprite.pixels, (int16_t)sprite.width, (int16_t)sprite.height, stride,
+           sprite.format, sprite.indices, sprite.palette, sprite.colors, sprite.rows, sprite.mask};
+  duration = sprite.duration;
+  return sprite.name;
+}
 
-  if (SPIFFS.exists("/tree.bin"))
+bool findSprite(const char *name, SpriteImage &image)
+{
+  for (int i = 0; i < spriteCount(); i++)
   {
-    gameData.trees[treeIndex].sprite->createSprite(TREE_WIDTH, TREE_HEIGHT);
-    fs::File file = SPIFFS.open("/tree.bin", "r");
-    if (file)
+    if (strcmp(embeddedSprites[i].name, name) == 0)
     {
-      uint16_t buffer[TREE_WIDTH * TREE_HEIGHT];
-      file.read((uint8_t *)buffer, TREE_WIDTH * TREE_HEIGHT * 2);
-      gameData.trees[treeIndex].sprite->pushImage(0, 0, TREE_WIDTH, TREE_HEIGHT, buffer);
-      file.close();
+      uint16_t duration;
+      spriteFrame(i, image, duration);
+      return true;
     }
   }
-  else
-  {
-    // Procedural fallback
-    gameData.trees[treeIndex].sprite->createSprite(TREE_WIDTH, TREE_HEIGHT);
-    gameData.trees[treeIndex].sprite->fillSprite(SKY_BLUE);
+  return false;
+}
+#else
+int spriteCount()
+{
+  return spriteAtlas.count();
+}
+
+const char *spriteFrame(int index, SpriteImage &image, uint16_t &duration)
+{
+  spriteAtlas.image(index, image);
+  duration = spriteAtlas.entry(index).duration;
+  return spriteAtlas.entry(index).name;
+}
 
-    int trunkWidth = 6;
-    int trunkHeight = TREE_HEIGHT / 4;
-    gameData.trees[treeIndex].sprite->fillRect(
-        TREE_WIDTH / 2 - trunkWidth / 2, TREE_HEIGHT - trunkHeight,
-        trunkWidth, trunkHeight, TREE_BROWN);
+bool findSprite(const char *name, SpriteImage &image)
+{
+  return spriteAtlas.find(name, image);
+}
+#endif
 
-    for (int i = 0; i < 3; i++)
-    {
-      int layerHeight = (TREE_HEIGHT - trunkHeight) / 3;
-      int layerWidth = TREE_WIDTH - i * 4;
-      int layerY = trunkHeight + i * layerHeight;
-      gameData.trees[treeIndex].sprite->fillTriangle(
-          TREE_WIDTH / 2, layerY,
-          TREE_WIDTH / 2 - layerWidth / 2, layerY + layerHeight,
-          TREE_WIDTH / 2 + layerWidth / 2, layerY + layerHeight,
-          TREE_GREEN);
-    }
+const SpriteSlot spriteSlots[] = {
+    {"sleigh0", SPRITE_SLEIGH0, SLEIGH_WIDTH, SLEIGH_HEIGHT, createDefaultSleigh},
+    {"sleigh1", SPRITE_SLEIGH1, SLEIGH_WIDTH, SLEIGH_HEIGHT, createDefaultSleigh2},
+    {"explosion0", SPRITE_EXPLOSION0, SLEIGH_WIDTH, SLEIGH_HEIGHT, createDefaultExplosion},
+    {"explosion1", SPRITE_EXPLOSION1, SLEIGH_WIDTH, SLEIGH_HEIGHT, createDefaultExplosion2},
+    {"tree0", SPRITE_TREE, TREE_WIDTH, TREE_HEIGHT, createDefaultTree},
+};
+
+const ClipSlot clipSlots[] = {
+    {"duck", CLIP_DUCK, DUCK_WIDTH, DUCK_HEIGHT, {createDefaultDuck, createDefaultDuck2}},
+    {"foe", CLIP_FOE, DUCK_WIDTH, DUCK_HEIGHT, {createDefaultFoe, createDefaultFoe2}},
+    {"gift", CLIP_GIFT, GIFT_WIDTH, GIFT_HEIGHT, {createDefaultGift, nullptr}},
+};
+
+// Whether a frame from the sprite source has the size the game's layout and hitboxes
+// are built for; a mismatched asset is rejected here rather than drawn out of place
+bool spriteFits(const char *name, const SpriteImage &image, int width, int height)
+{
+  if (image.width == width && image.height == height)
+  {
+    return true;
   }
+  Serial.printf("Sprite %s is %dx%d, the game expects %dx%d; not using it\n", name, image.width, image.height, width,
+                height);
+  return false;
 }
 
-void loadSpritesFromSPIFFS()
+// Collision mask of a procedural sprite: set wherever it is not sky. nullptr when it is too
+// wide for a mask or the pool is full.
+const uint32_t *buildFallbackMask(const SpriteImage &image)
 {
-  if (!SPIFFS.begin(true))
+  if (image.width > 32 || fallbackMaskRows + image.height > FALLBACK_MASK_ROWS)
   {
-    Serial.println("SPIFFS Mount Failed");
-    return;
+    return nullptr;
   }
-
-  // Load sleigh frame 1
-  if (SPIFFS.exists("/sleigh0.bin"))
+  uint32_t *mask = fallbackMasks + fallbackMaskRows;
+  fallbackMaskRows += image.height;
+  for (int y = 0; y < image.height; y++)
   {
-    sleighSprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-    fs::File file = SPIFFS.open("/sleigh0.bin", "r");
-    if (file)
+    const uint16_t *row = image.row(y);
+    mask[y] = 0;
+    for (int x = 0; x < image.width; x++)
     {
-      uint16_t buffer[SLEIGH_WIDTH * SLEIGH_HEIGHT];
-      file.read((uint8_t *)buffer, SLEIGH_WIDTH * SLEIGH_HEIGHT * 2);
-      sleighSprite.pushImage(0, 0, SLEIGH_WIDTH, SLEIGH_HEIGHT, buffer);
-      file.close();
+      if (row[x] != PANEL_COLOR(SKY_BLUE))
+      {
+        mask[y] |= 0x80000000u >> x;
+      }
     }
   }
-  else
+  return mask;
+}
+
+// Draw a procedural sprite with TFT_eSprite and copy it into the arena; the canvas
+// buffer is freed before the next one. Left empty when the arena is full.
+void drawDefaultSprite(TFT_eSprite &canvas, void (*createDefault)(TFT_eSprite &sprite), const char *name,
+                       SpriteImage &image)
+{
+  image = {};
+  createDefault(canvas);
+  int width = canvas.width();
+  int height = canvas.height();
+  uint16_t *pixels = pixelArena.allocate(width * height, name);
+  if (pixels != nullptr)
+  {
+    memcpy(pixels, canvas.getPointer(), width * height * sizeof(uint16_t));
+    image = rgb565Image(pixels, width, height, width);
+    image.mask = buildFallbackMask(image);
+  }
+  canvas.deleteSprite();
+}
+
+// Frame number of a sprite name that is <clip name><digits>, or -1
+int clipFrameIndex(const char *name, const char *clipName)
+{
+  size_t length = strlen(clipName);
+  if (strncmp(name, clipName, length) != 0 || name[length] < '0' || name[length] > '9')
   {
-    createDefaultSleigh();
+    return -1;
   }
+  char *end;
+  long index = strtol(name + length, &end, 10);
+  return *end == '\0' && index < MAX_CLIP_FRAMES ? (int)index : -1;
+}
 
-  // Load sleigh frame 2
-  if (SPIFFS.exists("/sleigh1.bin"))
+// Collect every clip's frames from the sprite source in one pass over it. A clip runs
+// from frame 0 to the first missing or misfit number; without a frame 0 it falls back to procedural frames.
+void loadAnimations(TFT_eSprite &canvas)
+{
+  for (int i = 0; i < spriteCount(); i++)
   {
-    sleighSprite2.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-    fs::File file = SPIFFS.open("/sleigh1.bin", "r");
-    if (file)
+    SpriteImage image;
+    uint16_t duration;
+    const char *name = spriteFrame(i, image, duration);
+    for (const ClipSlot &slot : clipSlots)
     {
-      uint16_t buffer[SLEIGH_WIDTH * SLEIGH_HEIGHT];
-      file.read((uint8_t *)buffer, SLEIGH_WIDTH * SLEIGH_HEIGHT * 2);
-      sleighSprite2.pushImage(0, 0, SLEIGH_WIDTH, SLEIGH_HEIGHT, buffer);
-      file.close();
+      int frame = clipFrameIndex(name, slot.name);
+      if (frame >= 0 && spriteFits(name, image, slot.width, slot.height))
+      {
+        Animation &animation = animations[slot.clip];
+        animation.frames[frame] = image;
+        animation.durations[frame] = duration != 0 ? duration : DUCK_FLAP_INTERVAL;
+      }
     }
   }
-  else
-  {
-    createDefaultSleigh2();
-  }
 
-  // Load duck frame 1
-  if (SPIFFS.exists("/duck0.bin"))
+  for (const ClipSlot &slot : clipSlots)
   {
-    duckSprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-    fs::File file = SPIFFS.open("/duck0.bin", "r");
-    if (file)
+    Animation &animation = animations[slot.clip];
+    while (animation.count < MAX_CLIP_FRAMES && !animation.frames[animation.count].empty())
+    {
+      animation.count++;
+    }
+    if (animation.count > 0)
+    {
+      continue;
+    }
+    for (int frame = 0; frame < 2 && slot.createDefault[frame] != nullptr; frame++)
     {
-      uint16_t buffer[DUCK_WIDTH * DUCK_HEIGHT];
-      file.read((uint8_t *)buffer, DUCK_WIDTH * DUCK_HEIGHT * 2);
-      duckSprite.pushImage(0, 0, DUCK_WIDTH, DUCK_HEIGHT, buffer);
-      file.close();
+      drawDefaultSprite(canvas, slot.createDefault[frame], slot.name, animation.frames[frame]);
+      animation.durations[frame] = DUCK_FLAP_INTERVAL;
+      animation.count++;
     }
   }
-  else
+}
+
+CollisionMask collisionMask(const SpriteImage &image)
+{
+  if (image.mask == nullptr || image.width > 32)
   {
-    createDefaultDuck();
+    return {};
   }
+  return {image.mask, (uint8_t)image.width, (uint8_t)image.height};
+}
 
-  // Load duck frame 2
-  if (SPIFFS.exists("/duck1.bin"))
+// Collect the masks of every frame the sleigh can hit, for pixel-exact collisions in the game core
+void loadCollisionMasks()
+{
+  collisionMasks.sleigh[0] = collisionMask(sprites[SPRITE_SLEIGH0]);
+  collisionMasks.sleigh[1] = collisionMask(sprites[SPRITE_SLEIGH1]);
+  collisionMasks.tree = collisionMask(sprites[SPRITE_TREE]);
+  for (int clip = 0; clip < CLIP_COUNT; clip++)
   {
-    duckSprite2.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-    fs::File file = SPIFFS.open("/duck1.bin", "r");
-    if (file)
+    for (int frame = 0; frame < animations[clip].count; frame++)
     {
-      uint16_t buffer[DUCK_WIDTH * DUCK_HEIGHT];
-      file.read((uint8_t *)buffer, DUCK_WIDTH * DUCK_HEIGHT * 2);
-      duckSprite2.pushImage(0, 0, DUCK_WIDTH, DUCK_HEIGHT, buffer);
-      file.close();
+      collisionMasks.clips[clip][frame] = collisionMask(animations[clip].frames[frame]);
     }
   }
-  else
+}
+
+// Point every sprite at its pixels in flash (the mapped atlas or the embedded arrays),
+// so pixel data is never copied to RAM. Missing or mis-sized frames are drawn procedurally into the arena.
+void loadSprites()
+{
+  if (spritesLoaded)
   {
-    createDefaultDuck2();
+    return;
   }
+  spritesLoaded = true;
 
-  // Load foe frame 1
-  if (SPIFFS.exists("/foe0.bin"))
+#if SPRITE_SOURCE == SPRITES_PARTITION
+  if (!mapAtlas(spriteAtlas, ATLAS_PARTITION_LABEL))
   {
-    foeSprite.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-    fs::File file = SPIFFS.open("/foe0.bin", "r");
-    if (file)
-    {
-      uint16_t buffer[DUCK_WIDTH * DUCK_HEIGHT];
-      file.read((uint8_t *)buffer, DUCK_WIDTH * DUCK_HEIGHT * 2);
-      foeSprite.pushImage(0, 0, DUCK_WIDTH, DUCK_HEIGHT, buffer);
-      file.close();
-    }
-  }
-  else
-  {
-    createDefaultFoe();
+    Serial.printf("No version %d sprite atlas in the sprites partition, using default sprites\n", ATLAS_VERSION);
   }
+#endif
 
-  // Load foe frame 2
-  if (SPIFFS.exists("/foe1.bin"))
+  TFT_eSprite canvas = TFT_eSprite(&tft);
+  for (size_t i = 0; i < sizeof(spriteSlots) / sizeof(spriteSlots[0]); i++)
   {
-    foeSprite2.createSprite(DUCK_WIDTH, DUCK_HEIGHT);
-    fs::File file = SPIFFS.open("/foe1.bin", "r");
-    if (file)
+    const SpriteSlot &slot = spriteSlots[i];
+    if (!findSprite(slot.name, sprites[slot.id]) || !spriteFits(slot.name, sprites[slot.id], slot.width, slot.height))
     {
-      uint16_t buffer[DUCK_WIDTH * DUCK_HEIGHT];
-      file.read((uint8_t *)buffer, DUCK_WIDTH * DUCK_HEIGHT * 2);
-      foeSprite2.pushImage(0, 0, DUCK_WIDTH, DUCK_HEIGHT, buffer);
-      file.close();
+      drawDefaultSprite(canvas, slot.createDefault, slot.name, sprites[slot.id]);
     }
   }
-  else
+  loadAnimations(canvas);
+
+  scoreBuffer = pixelArena.allocate(SCORE_WIDTH * SCORE_HEIGHT, "score");
+  loadCollisionMasks();
+}
+
+#if ARENA_REPORT
+void reportArena()
+{
+  Serial.printf("pixel arena: %lu of %lu bytes used\n", (unsigned long)(pixelArena.used * sizeof(uint16_t)),
+                (unsigned long)sizeof(pixelArena.pixels));
+  for (int i = 0; i < pixelArena.assetCount; i++)
+  {
+    Serial.printf("  %-12s %6lu bytes\n", pixelArena.assets[i].name,
+                  (unsigned long)(pixelArena.assets[i].pixels * sizeof(uint16_t)));
+  }
+}
+#endif
+
+// ============================================================================
+// PARTICLE EFFECTS
+// ============================================================================
+
+// Cheap xorshift for cosmetic randomness; random() is far too slow for thousands of particles
+uint32_t particleRandom()
+{
+  particleSeed ^= particleSeed << 13;
+  particleSeed ^= particleSeed >> 17;
+  particleSeed ^= particleSeed << 5;
+  return particleSeed;
+}
+
+// Random fixed-point value in [-range, range)
+int16_t particleJitter(int16_t range)
+{
+  return (int16_t)(particleRandom() % (2 * range)) - range;
+}
+
+void initializeParticles()
+{
+  const uint16_t sizes[POOL_COUNT] = {SNOW_POOL_SIZE, EXPLOSION_POOL_SIZE, SPARKLE_POOL_SIZE};
+  const int16_t gravity[POOL_COUNT] = {0, PARTICLE_ONE / 8, PARTICLE_ONE / 32};
+  const bool ageing[POOL_COUNT] = {false, true, true};
+  uint16_t first = 0;
+  for (int pool = 0; pool < POOL_COUNT; pool++)
   {
-    createDefaultFoe2();
+    particles.pools[pool] = {first, sizes[pool], 0, gravity[pool], ageing[pool]};
+    first += sizes[pool];
   }
+}
 
-  // Load gift
-  if (SPIFFS.exists("/gift0.bin"))
+void clearParticles()
+{
+  for (int pool = 0; pool < POOL_COUNT; pool++)
   {
-    giftSprite.createSprite(GIFT_WIDTH, GIFT_HEIGHT);
-    fs::File file = SPIFFS.open("/gift0.bin", "r");
-    if (file)
-    {
-      uint16_t buffer[GIFT_WIDTH * GIFT_HEIGHT];
-      file.read((uint8_t *)buffer, GIFT_WIDTH * GIFT_HEIGHT * 2);
-      giftSprite.pushImage(0, 0, GIFT_WIDTH, GIFT_HEIGHT, buffer);
-      file.close();
-    }
+    particles.pools[pool].count = 0;
   }
-  else
+}
+
+// Append a particle to a pool at screen position (x, y); dropped silently when the pool is full
+void emitParticle(ParticlePoolId id, int x, int y, int16_t vx, int16_t vy, uint16_t color, uint8_t life)
+{
+  ParticlePool &pool = particles.pools[id];
+  if (pool.count == pool.capacity)
   {
-    createDefaultGift();
+    return;
+  }
+  int i = pool.first + pool.count++;
+  particles.x[i] = x * PARTICLE_ONE;
+  particles.y[i] = y * PARTICLE_ONE;
+  particles.vx[i] = vx;
+  particles.vy[i] = vy;
+  particles.color[i] = color;
+  particles.life[i] = life;
+}
+
+// Keep the gameplay snow topped up; new flakes enter from the top
+void emitSnow(int target, bool anywhere)
+{
+  while (particles.pools[POOL_SNOW].count < target && particles.pools[POOL_SNOW].count < SNOW_POOL_SIZE)
+  {
+    int y = anywhere ? particleRandom() % PLAYFIELD_HEIGHT : 0;
+    emitParticle(POOL_SNOW, particleRandom() % SCREEN_WIDTH, y,
+                 particleJitter(PARTICLE_ONE / 4), PARTICLE_ONE / 2 + particleRandom() % (PARTICLE_ONE / 2),
+                 WHITE, 0);
+  }
+}
+
+// Game over snow: start over with flakes scattered over and just above the screen, for updateSnow
+void emitSnowPile()
+{
+  clearParticles();
+  for (int i = 0; i < GAMEOVER_SNOWFLAKES; i++)
+  {
+    emitParticle(POOL_SNOW, particleRandom() % SCREEN_WIDTH, (int)(particleRandom() % (SCREEN_HEIGHT + 20)) - 20, 0, 0,
+                 WHITE, 0);
+  }
+}
+
+void emitExplosion(int x, int y)
+{
+  const uint16_t colors[] = {TFT_RED, TFT_ORANGE, TFT_YELLOW, WHITE};
+  for (int i = 0; i < EXPLOSION_PARTICLES; i++)
+  {
+    emitParticle(POOL_EXPLOSION, x, y, particleJitter(3 * PARTICLE_ONE), particleJitter(3 * PARTICLE_ONE) - PARTICLE_ONE,
+                 colors[particleRandom() % 4], 20 + particleRandom() % 30);
   }
+}
+
+void emitSparkles(int x, int y)
+{
+  for (int i = 0; i < SPARKLE_PARTICLES; i++)
+  {
+    emitParticle(POOL_SPARKLE, x, y, particleJitter(2 * PARTICLE_ONE), particleJitter(2 * PARTICLE_ONE),
+                 (particleRandom() & 1) ? TFT_YELLOW : WHITE, 10 + particleRandom() % 15);
+  }
+}
+
+// Move every particle one frame, then drop the ones that died or left the playfield
+void updateParticles()
+{
+  const int32_t maxX = SCREEN_WIDTH << PARTICLE_FRAC_BITS;
+  const int32_t maxY = PLAYFIELD_HEIGHT << PARTICLE_FRAC_BITS;
 
-  // Load explosion frame 1
-  if (SPIFFS.exists("/explosion0.bin"))
+  for (int id = 0; id < POOL_COUNT; id++)
   {
-    explosionSprite.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-    fs::File file = SPIFFS.open("/explosion0.bin", "r");
-    if (file)
+    ParticlePool &pool = particles.pools[id];
+    int first = pool.first;
+    int end = pool.first + pool.count;
+
+    for (int i = first; i < end; i++)
+    {
+      particles.vy[i] += pool.gravity;
+      particles.x[i] += particles.vx[i];
+      particles.y[i] += particles.vy[i];
+    }
+    if (pool.ageing)
+    {
+      for (int i = first; i < end; i++)
+      {
+        particles.life[i]--;
+      }
+    }
+
+    // Swap-remove keeps the live particles packed at the front of the pool
+    for (int i = first; i < end;)
     {
-      uint16_t buffer[SLEIGH_WIDTH * SLEIGH_HEIGHT];
-      file.read((uint8_t *)buffer, SLEIGH_WIDTH * SLEIGH_HEIGHT * 2);
-      explosionSprite.pushImage(0, 0, SLEIGH_WIDTH, SLEIGH_HEIGHT, buffer);
-      file.close();
+      bool dead = (pool.ageing && particles.life[i] == 0) ||
+                  (uint32_t)particles.x[i] >= (uint32_t)maxX ||
+                  particles.y[i] >= maxY || particles.y[i] < -maxY;
+      if (!dead)
+      {
+        i++;
+        continue;
+      }
+      end--;
+      particles.x[i] = particles.x[end];
+      particles.y[i] = particles.y[end];
+      particles.vx[i] = particles.vx[end];
+      particles.vy[i] = particles.vy[end];
+      particles.color[i] = particles.color[end];
+      particles.life[i] = particles.life[end];
     }
+    pool.count = end - first;
   }
-  else
+}
+
+// Write every particle inside rows [bufferY, bufferY + bufferHeight) and columns
+// [bufferX, bufferX + bufferWidth) into a RAM buffer that is bufferWidth pixels wide and in panel byte order
+void rasterizeParticles(uint16_t *buffer, int bufferY, int bufferHeight, int bufferX = 0, int bufferWidth = SCREEN_WIDTH)
+{
+  if (bufferHeight <= 0)
+  {
+    return;
+  }
+  for (int id = 0; id < POOL_COUNT; id++)
   {
-    createDefaultExplosion();
+    const ParticlePool &pool = particles.pools[id];
+    int end = pool.first + pool.count;
+    for (int i = pool.first; i < end; i++)
+    {
+      int y = (particles.y[i] >> PARTICLE_FRAC_BITS) - bufferY;
+      int x = (particles.x[i] >> PARTICLE_FRAC_BITS) - bufferX;
+      if ((unsigned)y < (unsigned)bufferHeight && (unsigned)x < (unsigned)bufferWidth)
+      {
+        buffer[y * bufferWidth + x] = PANEL_COLOR(particles.color[i]);
+      }
+    }
   }
+}
 
-  // Load explosion frame 2
-  if (SPIFFS.exists("/explosion1.bin"))
+// Bounding box of every live particle (w == 0 when there are none)
+Rect particleExtent()
+{
+  int32_t minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+  for (int id = 0; id < POOL_COUNT; id++)
   {
-    explosionSprite2.createSprite(SLEIGH_WIDTH, SLEIGH_HEIGHT);
-    fs::File file = SPIFFS.open("/explosion1.bin", "r");
-    if (file)
+    const ParticlePool &pool = particles.pools[id];
+    int end = pool.first + pool.count;
+    for (int i = pool.first; i < end; i++)
     {
-      uint16_t buffer[SLEIGH_WIDTH * SLEIGH_HEIGHT];
-      file.read((uint8_t *)buffer, SLEIGH_WIDTH * SLEIGH_HEIGHT * 2);
-      explosionSprite2.pushImage(0, 0, SLEIGH_WIDTH, SLEIGH_HEIGHT, buffer);
-      file.close();
+      minX = min(minX, particles.x[i]);
+      maxX = max(maxX, particles.x[i]);
+      minY = min(minY, particles.y[i]);
+      maxY = max(maxY, particles.y[i]);
     }
   }
-  else
+  if (maxX == INT32_MIN)
   {
-    createDefaultExplosion2();
+    return {};
   }
-
-  scoreSprite.createSprite(100, 16);
+  Rect extent = {(int16_t)(minX >> PARTICLE_FRAC_BITS), (int16_t)(minY >> PARTICLE_FRAC_BITS),
+                 (int16_t)(((maxX - minX) >> PARTICLE_FRAC_BITS) + 2), (int16_t)(((maxY - minY) >> PARTICLE_FRAC_BITS) + 2)};
+  return extent;
 }
 
-// ============================================================================
-// INITIALIZATION
-// ============================================================================
+#if PARTICLE_BENCHMARK
+// Fill every pool, then time update + raster passes into a scratch frame and report throughput
+void benchmarkParticles()
+{
+  const int frames = 100;
+  uint16_t *scratch = (uint16_t *)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t));
 
-void initializeGameData()
-{
-  gameData.state = STATE_MENU;
-  gameData.lastStateChange = millis();
-
-  gameData.sleighY = 30;
-  gameData.sleighVelocity = 0;
-  gameData.sleighOldY = gameData.sleighY;
-  gameData.sleighCrashed = false;
-  gameData.sleighExploding = false;
-  gameData.explosionStartTime = 0;
-
-  gameData.currentScore = 0;
-  gameData.buttonPressed = false;
-
-  gameData.lastDuckFlap = 0;
-  gameData.duckFrame = false;
-  gameData.gameOverScreenDrawn = false;
-  gameData.highScoreUpdated = false;
-
-  // Initialize trees - spread them out at start
-  for (int i = 0; i < TREE_COUNT; i++)
-  {
-    gameData.trees[i].pos.x = SCREEN_WIDTH + (i * OBSTACLE_SPAWN_DISTANCE);
-    gameData.trees[i].pos.y = PLAYFIELD_HEIGHT - TREE_HEIGHT;
-    gameData.trees[i].pos.oldX = gameData.trees[i].pos.x;
-    gameData.trees[i].pos.oldY = gameData.trees[i].pos.y;
-    gameData.trees[i].active = (i < 3); // Only first 3 are active at start
-    gameData.trees[i].spawnTimer = 0;
-    gameData.trees[i].scored = false;
-    gameData.trees[i].sprite = nullptr;
-    createTreeSprite(i);
-  }
-
-  // Initialize flying obstacles - spread them out at start
-  for (int i = 0; i < DUCK_COUNT; i++)
-  {
-    gameData.flyingObstacles[i].pos.x = SCREEN_WIDTH + (i * OBSTACLE_SPAWN_DISTANCE) + OBSTACLE_SPAWN_OFFSET;
-    gameData.flyingObstacles[i].pos.y = random(5, 40);
-    gameData.flyingObstacles[i].pos.oldX = gameData.flyingObstacles[i].pos.x;
-    gameData.flyingObstacles[i].pos.oldY = gameData.flyingObstacles[i].pos.y;
-    gameData.flyingObstacles[i].active = (i < 3); // Only first 3 are active at start
-    gameData.flyingObstacles[i].spawnTimer = 0;
-    gameData.flyingObstacles[i].scored = false;
-    gameData.flyingObstacles[i].lastFlap = 0;
-    gameData.flyingObstacles[i].flapFrame = false;
-    gameData.flyingObstacles[i].falling = false;
-    gameData.flyingObstacles[i].fallVelocity = 0;
-    // Randomly assign type: 80% duck, 16% gift, 4% foe
-    int randType = random(100);
-    if (randType < 80)
-    {
-      gameData.flyingObstacles[i].type = TYPE_DUCK;
-    }
-    else if (randType < 96)
+  uint32_t elapsed = 0;
+  uint32_t processed = 0;
+  for (int frame = 0; frame < frames; frame++)
+  {
+    // Refill what died so every frame runs at full capacity
+    for (int id = 0; id < POOL_COUNT; id++)
     {
-      gameData.flyingObstacles[i].type = TYPE_GIFT;
+      while (particles.pools[id].count < particles.pools[id].capacity)
+      {
+        emitParticle((ParticlePoolId)id, particleRandom() % SCREEN_WIDTH, particleRandom() % PLAYFIELD_HEIGHT,
+                     particleJitter(PARTICLE_ONE), particleJitter(PARTICLE_ONE), WHITE, 255);
+      }
     }
-    else
+    processed += PARTICLE_CAPACITY;
+
+    uint32_t start = micros();
+    updateParticles();
+    if (scratch != nullptr)
     {
-      gameData.flyingObstacles[i].type = TYPE_FOE;
-      // Foe spawns at middle height for easier combat
-      gameData.flyingObstacles[i].pos.y = PLAYFIELD_HEIGHT / 2 - DUCK_HEIGHT / 2;
+      rasterizeParticles(scratch, 0, SCREEN_HEIGHT);
     }
+    elapsed += micros() - start;
   }
+
+  Serial.printf("particles: %lu particles/ms (%d per frame, %lu us/frame%s)\n",
+                (unsigned long)(processed * 1000ULL / (elapsed > 0 ? elapsed : 1)), PARTICLE_CAPACITY,
+                (unsigned long)(elapsed / frames), scratch != nullptr ? "" : ", update only");
+  free(scratch);
+  clearParticles();
 }
+#endif
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
 
-void initializeSnow()
+// Accept an edge unless it is bounce, and queue it with the time it happened
+void IRAM_ATTR queueButtonEdge(uint8_t button, bool down, uint32_t now)
 {
-  for (int i = 0; i < MAX_SNOWFLAKES; i++)
+  ButtonState &state = buttons[button];
+  if (down == state.down || now - state.lastEdge < DEBOUNCE_US)
   {
-    gameData.snowflakes[i].x = random(0, SCREEN_WIDTH);
-    gameData.snowflakes[i].y = random(-20, SCREEN_HEIGHT);
-    gameData.snowflakes[i].active = true;
+    return;
   }
+  state.down = down;
+  state.lastEdge = now;
+  inputQueue.push({now, button, down});
+}
+
+void IRAM_ATTR onButtonEdge()
+{
+  uint32_t now = micros();
+  portENTER_CRITICAL_ISR(&inputMux);
+  queueButtonEdge(0, !digitalRead(BUTTON_PIN), now); // Active LOW
+  portEXIT_CRITICAL_ISR(&inputMux);
+}
+
+void IRAM_ATTR onButton2Edge()
+{
+  uint32_t now = micros();
+  portENTER_CRITICAL_ISR(&inputMux);
+  queueButtonEdge(1, !digitalRead(BUTTON2_PIN), now); // Active LOW
+  portEXIT_CRITICAL_ISR(&inputMux);
+}
+
+void setupButtonInterrupts()
+{
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), onButtonEdge, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(BUTTON2_PIN), onButton2Edge, CHANGE);
+}
+
+void clearScreen()
+{
+  tft.fillScreen(SKY_BLUE);
+  tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
+  renderFullFlush = true;
+  previousRects.clear();
+  memset(frameItems, 0, sizeof(frameItems));
+  memset(drawnSlots, 0, sizeof(drawnSlots));
+  lastFlushedScore = -1;
+  clearParticles();
+  particleBounds = {};
+  memset(particleDamage, 0, sizeof(particleDamage));
+}
+
+#if RESTART_HEAP_CHECK
+// Restart the game over and over the way the player does (simulation and screen reset)
+// and report the heap: restarts must reuse the shared sprites and allocate nothing
+void checkRestartHeap()
+{
+  uint32_t before = ESP.getFreeHeap();
+  StepInput restart = {true, false, 0};
+  for (int round = 0; round < RESTART_CHECK_ROUNDS; round++)
+  {
+    gameData.state = STATE_GAME_OVER;
+    applyInput(gameData, restart);
+    loadSprites();
+    clearScreen();
+  }
+  uint32_t after = ESP.getFreeHeap();
+  Serial.printf("restart heap: %lu bytes free before %d restarts, %lu after (%ld), lowest %lu\n",
+                (unsigned long)before, RESTART_CHECK_ROUNDS, (unsigned long)after, (long)after - (long)before,
+                (unsigned long)ESP.getMinFreeHeap());
 }
+#endif
 
 void setup()
 {
   Serial.begin(115200);
   pinMode(BUTTON_PIN, INPUT_PULLUP);
   pinMode(BUTTON2_PIN, INPUT_PULLUP);
+  setupButtonInterrupts();
 
   // Load high score from NVM
   preferences.begin("flappysleigh", false);
@@ -638,545 +1454,370 @@ void setup()
   tft.setRotation(3);
   tft.fillScreen(SKY_BLUE);
 
-  loadSpritesFromSPIFFS();
-  initializeGameData();
-
-  tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
-}
-void clearScreen()
-{
-  tft.fillScreen(SKY_BLUE);
-  tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
-}
-// ============================================================================
-// INPUT HANDLING
-// ============================================================================
-
-void handleInput()
-{
-  bool currentButton = !digitalRead(BUTTON_PIN);   // Active LOW
-  bool currentButton2 = !digitalRead(BUTTON2_PIN); // Active LOW
-  bool button1Event = false;
-  bool button2Event = false;
-
-  if (currentButton2 && !gameData.buttonPressed)
+  loadSprites();
+  for (int clip = 0; clip < CLIP_COUNT; clip++)
   {
-    gameData.buttonPressed = true;
-    button2Event = true;
+    setClip(gameData, (ClipId)clip, animations[clip].durations, animations[clip].count);
   }
-  if (currentButton && !gameData.buttonPressed)
+  gameData.masks = &collisionMasks;
+  seedGame(gameData, esp_random());
+  initializeGameData(gameData);
+  initializeParticles();
+#if PARTICLE_BENCHMARK
+  benchmarkParticles();
+#endif
+#if RESTART_HEAP_CHECK
+  checkRestartHeap();
+#endif
+
+  particleStaging = pixelArena.allocate(PARTICLE_STAGING_PIXELS, "particles"); // Direct paths, and the fallback
+#if RENDER_MODE == RENDER_FRAMEBUFFER
+  frameBuffer = pixelArena.allocate(SCREEN_WIDTH * SCREEN_HEIGHT, "framebuffer");
+  if (frameBuffer != nullptr)
   {
-    gameData.buttonPressed = true;
-    button1Event = true;
+    renderMode = RENDER_FRAMEBUFFER;
   }
-  if (!currentButton && !currentButton2)
+#elif RENDER_MODE == RENDER_BANDS
+  bandBuffers[0] = pixelArena.allocate(SCREEN_WIDTH * BAND_HEIGHT, "band0");
+  bandBuffers[1] = pixelArena.allocate(SCREEN_WIDTH * BAND_HEIGHT, "band1");
+  if (bandBuffers[1] != nullptr && tft.initDMA())
   {
-    gameData.buttonPressed = false;
-    return;
+    renderMode = RENDER_BANDS;
   }
-  bool action = button1Event || button2Event;
-  switch (gameData.state)
+  else
   {
-  case STATE_MENU:
-    if (button2Event)
-    {
-      gameData.gameMode = (GameMode)((gameData.gameMode + 1) % 3);
-    }
-    if (button1Event)
-    {
-      gameData.state = STATE_PLAYING;
-      gameData.lastStateChange = millis();
-      clearScreen();
-    }
-    break;
-  case STATE_PLAYING:
-    if (action && !gameData.sleighCrashed)
-    {
-      gameData.sleighVelocity = JUMP_STRENGTH;
-    }
-    else if (action && gameData.sleighCrashed && gameData.gameMode == MODE_CHEAT)
-    {
-      if (gameData.crashingStartTime + 300 < millis())
-      {
-        gameData.sleighCrashed = false;
-        gameData.sleighVelocity = JUMP_STRENGTH / 2;
-      }
-    }
-    break;
-  case STATE_GAME_OVER:
-    if (action)
-    {
-      // Reset game
-      gameData.state = STATE_MENU;
-      gameData.lastStateChange = millis();
-      gameData.currentScore = 0;
-      gameData.gameOverScreenDrawn = false;
-      gameData.highScoreUpdated = false;
-      initializeGameData();
-      clearScreen();
-    }
+    Serial.println("DMA init failed, using direct rendering");
   }
-}
-
-// ============================================================================
-// PHYSICS & UPDATES
-// ============================================================================
-
-void updatePhysics()
-{
-  // Stop physics when exploding
-  if (gameData.sleighExploding)
+#elif RENDER_MODE == RENDER_QUEUED
+  displayQueue.staging[0] = pixelArena.allocate(QUEUE_STAGING_PIXELS, "queue0");
+  displayQueue.staging[1] = pixelArena.allocate(QUEUE_STAGING_PIXELS, "queue1");
+  if (displayQueue.staging[1] != nullptr && tft.initDMA())
   {
-    return;
+    renderMode = RENDER_QUEUED;
   }
-
-  float currentGravity = GRAVITY;
-
-  // Double gravity when sleigh is crashed
-  if (gameData.sleighCrashed)
+  else
   {
-    currentGravity *= 2.0;
+    Serial.println("DMA init failed, using direct rendering");
   }
+#endif
+#if ARENA_REPORT
+  reportArena();
+#endif
+
+  tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
 
-  gameData.sleighVelocity += currentGravity;
-  gameData.sleighOldY = gameData.sleighY;
-  gameData.sleighY += gameData.sleighVelocity;
+#if !DUAL_CORE
+  lastTickMicros = micros();
+#endif
 }
+// ============================================================================
+// INPUT HANDLING
+// ============================================================================
 
-void updateFlyingAnimation()
+// An edge swallowed by the debounce window (a very short tap) leaves the
+// reported level stale; catch up once the line has been stable long enough
+void reconcileButtons()
 {
-  uint32_t currentTime = millis();
-
-  // Update animation for each flying obstacle independently
-  for (int i = 0; i < DUCK_COUNT; i++)
+  uint32_t now = micros();
+  portENTER_CRITICAL(&inputMux);
+  for (int i = 0; i < BUTTON_COUNT; i++)
   {
-    if (gameData.flyingObstacles[i].active)
-    {
-      // Only ducks and foes have flapping animation
-      if (gameData.flyingObstacles[i].type == TYPE_DUCK ||
-          gameData.flyingObstacles[i].type == TYPE_FOE)
-      {
-        // Check if it's time to switch frames
-        if (currentTime - gameData.flyingObstacles[i].lastFlap >= DUCK_FLAP_INTERVAL)
-        {
-          gameData.flyingObstacles[i].flapFrame = !gameData.flyingObstacles[i].flapFrame;
-          gameData.flyingObstacles[i].lastFlap = currentTime;
-        }
-      }
-    }
-
-    // Update falling foes
-    if (gameData.flyingObstacles[i].falling)
+    if (now - buttons[i].lastEdge >= DEBOUNCE_US)
     {
-      gameData.flyingObstacles[i].fallVelocity += GRAVITY;
-      gameData.flyingObstacles[i].pos.move(0, (int)gameData.flyingObstacles[i].fallVelocity);
-
-      // Remove if hit ground
-      if (gameData.flyingObstacles[i].pos.y >= PLAYFIELD_HEIGHT)
-      {
-        gameData.flyingObstacles[i].falling = false;
-        gameData.flyingObstacles[i].active = false;
-        gameData.flyingObstacles[i].spawnTimer = currentTime + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-      }
+      queueButtonEdge(i, !digitalRead(buttons[i].pin), now);
     }
   }
+  portEXIT_CRITICAL(&inputMux);
 }
 
-// Check if an obstacle at the given position would overlap with any active obstacles
-bool obstacleOverlapsWithOthers(int newX, int newY, int obstacleIndex)
+// Collect every input event that happened before the end of this step (stepEnd, in micros())
+StepInput readInput(uint32_t stepEnd)
 {
-  const int X_MARGIN = 30; // Minimum horizontal distance between obstacles
-  const int Y_MARGIN = 20; // Minimum vertical distance between obstacles
+  reconcileButtons();
 
-  for (int i = 0; i < DUCK_COUNT; i++)
+  StepInput input = {false, false, 0};
+  uint32_t pressTime = 0;
+  InputEvent event;
+  while (inputQueue.peek(event) && (int32_t)(event.timestamp - stepEnd) <= 0)
   {
-    if (i == obstacleIndex || !gameData.flyingObstacles[i].active || gameData.flyingObstacles[i].falling)
+    inputQueue.pop();
+    uint8_t mask = 1 << event.button;
+    if (!event.pressed)
     {
-      continue; // Skip self, inactive, and falling obstacles
+      buttonsDown &= ~mask;
+      continue;
     }
-
-    // Check both x and y overlap with margin
-    int xDistance = newX - gameData.flyingObstacles[i].pos.x;
-    if (xDistance < 0)
-      xDistance = -xDistance;
-
-    int yDistance = newY - gameData.flyingObstacles[i].pos.y;
-    if (yDistance < 0)
-      yDistance = -yDistance;
-
-    // If both distances are too small, there's an overlap
-    if (xDistance < X_MARGIN && yDistance < Y_MARGIN)
+    // A press only counts when no other button is already held
+    if (buttonsDown == 0)
     {
-      return true; // Overlap detected
+      (event.button == 0 ? input.button1 : input.button2) = true;
+      pressTime = event.timestamp;
     }
+    buttonsDown |= mask;
   }
 
-  return false; // No overlap
+  if (input.button1 || input.button2)
+  {
+    int32_t intoStep = (int32_t)(pressTime - (stepEnd - SIM_STEP_US));
+    input.pressFraction = intoStep <= 0 ? 0 : (fixed_t)(((int64_t)intoStep << FIXED_SHIFT) / SIM_STEP_US);
+  }
+  return input;
 }
 
-bool treeOverlapsWithOthers(int newX, int treeIndex)
+// ============================================================================
+// SNOW
+// ============================================================================
+
+bool snowOccupied(int x, int y)
 {
-  const int OVERLAP_MARGIN = 20; // Minimum distance between trees
+  return snowOccupancy[y][x >> 5] & (1u << (x & 31));
+}
 
-  for (int i = 0; i < TREE_COUNT; i++)
+void snowMark(int x, int y)
+{
+  snowOccupancy[y][x >> 5] |= 1u << (x & 31);
+  if (y < snowSurface[x])
   {
-    if (i == treeIndex || !gameData.trees[i].active)
-    {
-      continue; // Skip self and inactive trees
-    }
-
-    // Check if x positions are too close (simple horizontal overlap detection)
-    int distance = newX - gameData.trees[i].pos.x;
-    if (distance < 0)
-      distance = -distance;
-
-    if (distance < OVERLAP_MARGIN)
-    {
-      return true; // Overlap detected
-    }
+    snowSurface[x] = y;
   }
-
-  return false; // No overlap
 }
 
-void updateObstacles()
+void snowMarkRect(int x, int y, int w, int h)
 {
-  uint32_t currentTime = millis();
-  if (gameData.sleighExploding)
+  Rect r = {(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h};
+  if (!r.clip())
   {
     return;
   }
-  // Update trees
-  for (int i = 0; i < TREE_COUNT; i++)
+  for (int row = r.y; row < r.y + r.h; row++)
   {
-    if (gameData.trees[i].active)
-    {
-      // Move active tree
-      gameData.trees[i].pos.move(-OBSTACLE_SPEED);
-
-      // Check if tree went off-screen
-      if (gameData.trees[i].pos.x < -TREE_WIDTH)
-      {
-        gameData.trees[i].active = false;
-        gameData.trees[i].scored = false;
-        // Start spawn delay timer
-        gameData.trees[i].spawnTimer = currentTime + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-      }
-    }
-    else
+    for (int col = r.x; col < r.x + r.w; col++)
     {
-      // Check if spawn delay is over
-      if (currentTime >= gameData.trees[i].spawnTimer)
-      {
-        // Try to respawn tree
-        gameData.trees[i].pos.x = SCREEN_WIDTH;
-        gameData.trees[i].pos.y = PLAYFIELD_HEIGHT - TREE_HEIGHT;
-        gameData.trees[i].pos.oldX = gameData.trees[i].pos.x;
-        gameData.trees[i].pos.oldY = gameData.trees[i].pos.y;
-
-        // Check if this overlaps with other trees
-        if (treeOverlapsWithOthers(gameData.trees[i].pos.x, i))
-        {
-          // Overlap detected, reschedule spawn
-          gameData.trees[i].spawnTimer = currentTime + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-        }
-        else
-        {
-          // No overlap, activate the tree
-          gameData.trees[i].active = true;
-          gameData.trees[i].scored = false;
-        }
-      }
+      snowMark(col, row);
     }
   }
+}
 
-  // Update flying obstacles
-  for (int i = 0; i < DUCK_COUNT; i++)
+// Mark every non-sky pixel of a sprite placed at (x, y)
+void snowMarkSprite(const SpriteImage *sprite, int x, int y)
+{
+  if (sprite->empty())
+  {
+    snowMarkRect(x, y, sprite->width, sprite->height);
+    return;
+  }
+  uint16_t scratch[SCREEN_WIDTH];
+  for (int row = 0; row < sprite->height; row++)
   {
-    if (gameData.flyingObstacles[i].active && !gameData.flyingObstacles[i].falling)
+    if (y + row < 0 || y + row >= SCREEN_HEIGHT)
     {
-      // Move active obstacle
-      gameData.flyingObstacles[i].pos.move(-OBSTACLE_SPEED);
-
-      // Check if obstacle went off-screen
-      if (gameData.flyingObstacles[i].pos.x < -DUCK_WIDTH * 2)
-      {
-        gameData.flyingObstacles[i].active = false;
-        gameData.flyingObstacles[i].scored = false;
-        // Start spawn delay timer
-        gameData.flyingObstacles[i].spawnTimer = currentTime + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-      }
+      continue;
     }
-    else if (!gameData.flyingObstacles[i].active && !gameData.flyingObstacles[i].falling)
+    const uint16_t *pixels = imageRow(*sprite, row, 0, sprite->width, scratch);
+    for (int col = 0; col < sprite->width; col++)
     {
-      // Check if spawn delay is over
-      if (currentTime >= gameData.flyingObstacles[i].spawnTimer)
+      if (x + col >= 0 && x + col < SCREEN_WIDTH && pixels[col] != PANEL_COLOR(SKY_BLUE))
       {
-        // Respawn obstacle
-        gameData.flyingObstacles[i].pos.x = SCREEN_WIDTH;
-        gameData.flyingObstacles[i].pos.y = random(5, 40);
-        gameData.flyingObstacles[i].pos.oldX = gameData.flyingObstacles[i].pos.x;
-        gameData.flyingObstacles[i].pos.oldY = gameData.flyingObstacles[i].pos.y;
-        gameData.flyingObstacles[i].falling = false;
-        gameData.flyingObstacles[i].fallVelocity = 0;
-        // Randomly assign new type: 80% duck, 16% gift, 4% foe
-        int randType = random(100);
-        if (randType < 80)
-        {
-          gameData.flyingObstacles[i].type = TYPE_DUCK;
-        }
-        else if (randType < 96)
-        {
-          gameData.flyingObstacles[i].type = TYPE_GIFT;
-        }
-        else
-        {
-          gameData.flyingObstacles[i].type = TYPE_FOE;
-          // Foe spawns at middle height for easier combat
-          gameData.flyingObstacles[i].pos.y = PLAYFIELD_HEIGHT / 2 - DUCK_HEIGHT / 2;
-        }
-
-        // Check if this overlaps with other obstacles
-        if (obstacleOverlapsWithOthers(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y, i))
-        {
-          // Overlap detected, reschedule spawn
-          gameData.flyingObstacles[i].spawnTimer = currentTime + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-        }
-        else
-        {
-          // No overlap, activate the obstacle
-          gameData.flyingObstacles[i].active = true;
-          gameData.flyingObstacles[i].scored = false;
-        }
+        snowMark(x + col, y + row);
       }
     }
   }
 }
 
-void updateScore()
+// Rebuild the occupancy map from what is on screen under the game over panel,
+// so the snow never has to read pixels back from the display
+void buildSnowMap(int panelX, int panelY, int panelW, int panelH)
 {
-  // Don't score points if sleigh has crashed
-  if (gameData.sleighCrashed)
+  memset(snowOccupancy, 0, sizeof(snowOccupancy));
+  for (int x = 0; x < SCREEN_WIDTH; x++)
   {
-    return;
+    snowSurface[x] = SCREEN_HEIGHT;
   }
 
-  for (int i = 0; i < TREE_COUNT; i++)
+  for (int i = 0; i < DRAW_SLOTS; i++)
   {
-    if (gameData.trees[i].active && !gameData.trees[i].scored &&
-        gameData.trees[i].pos.x + TREE_WIDTH < SLEIGH_START_X)
+    if (frameItems[i].sprite != nullptr)
     {
-      gameData.trees[i].scored = true;
-      gameData.currentScore++;
+      snowMarkSprite(frameItems[i].sprite, frameItems[i].x, frameItems[i].y);
     }
   }
+  snowMarkRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT);
+  snowMarkRect(panelX, panelY, panelW, panelH);
+}
 
-  for (int i = 0; i < DUCK_COUNT; i++)
+// Whether a flake cannot move into (x, y)
+bool snowBlocked(int x, int y)
+{
+  if (y >= SCREEN_HEIGHT)
   {
-    if (gameData.flyingObstacles[i].active && !gameData.flyingObstacles[i].scored &&
-        !gameData.flyingObstacles[i].falling &&
-        gameData.flyingObstacles[i].pos.x + DUCK_WIDTH < SLEIGH_START_X)
-    {
-      gameData.flyingObstacles[i].scored = true;
-      // Only ducks and foes give points for passing
-      if (gameData.flyingObstacles[i].type == TYPE_DUCK ||
-          gameData.flyingObstacles[i].type == TYPE_FOE)
-      {
-        gameData.currentScore++;
-      }
-    }
+    return true;
+  }
+  if (y < snowSurface[x])
+  {
+    return false; // Above everything in this column
   }
+  return snowOccupied(x, y);
 }
 
+// Game over snow: every flake in POOL_SNOW falls a pixel per step until it lands on the panel,
+// a sprite or the pile, then stays there and starts over from the top. A fall is one window of
+// two pixels, sky above the flake.
 void updateSnow()
 {
-  for (int i = 0; i < MAX_SNOWFLAKES; i++)
+  const ParticlePool &pool = particles.pools[POOL_SNOW];
+  int end = pool.first + pool.count;
+  tft.startWrite();
+  for (int i = pool.first; i < end; i++)
   {
-    if (gameData.snowflakes[i].active)
+    int x = particles.x[i] >> PARTICLE_FRAC_BITS;
+    int y = particles.y[i] >> PARTICLE_FRAC_BITS;
+
+    // Spawned inside something (panel, tree, pile): never paint over it
+    bool buried = y >= 0 && snowOccupied(x, y);
+
+    if (!buried && !snowBlocked(x, y + 1))
     {
-      if (gameData.snowflakes[i].y < SCREEN_HEIGHT - 1)
+      particles.y[i] += PARTICLE_ONE;
+      if (y + 1 >= 0)
       {
-        uint16_t pixelBelow = tft.readPixel(gameData.snowflakes[i].x, gameData.snowflakes[i].y + 1);
-
-        if (pixelBelow == SKY_BLUE)
-        {
-          tft.drawPixel(gameData.snowflakes[i].x, gameData.snowflakes[i].y, SKY_BLUE);
-          gameData.snowflakes[i].y++;
-          tft.drawPixel(gameData.snowflakes[i].x, gameData.snowflakes[i].y, WHITE);
-        }
-        else
+        tft.setAddrWindow(x, y >= 0 ? y : 0, 1, y >= 0 ? 2 : 1);
+        if (y >= 0)
         {
-          gameData.snowflakes[i].x = random(0, SCREEN_WIDTH);
-          gameData.snowflakes[i].y = 0;
+          tft.pushBlock(SKY_BLUE, 1);
         }
+        tft.pushBlock(WHITE, 1);
       }
-      else
-      {
-        gameData.snowflakes[i].x = random(0, SCREEN_WIDTH);
-        gameData.snowflakes[i].y = 0;
-      }
+      continue;
+    }
+
+    // Landed: the flake stays on screen and becomes part of the pile
+    if (!buried && y >= 0)
+    {
+      tft.drawPixel(x, y, WHITE);
+      snowMark(x, y);
     }
+    particles.x[i] = (particleRandom() % SCREEN_WIDTH) * PARTICLE_ONE;
+    particles.y[i] = 0;
   }
+  tft.endWrite();
 }
 
-// ============================================================================
-// COLLISION DETECTION
-// ============================================================================
+// Persist a beaten forever record to NVM
+void saveHighScore(const GameData &data)
+{
+  char key[16];
+  sprintf(key, "highscore%d", data.gameMode);
+  preferences.putInt(key, data.foreverHighScore[data.gameMode]);
+}
+
+// ============================================================================
+// RENDERING
+// ============================================================================
 
-void checkCollisions()
+// 127 * sin(i * pi / 128) for a quarter turn
+const int8_t SINE_QUARTER[65] = {
+    0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46, 49, 51, 54, 57, 60, 63,
+    65, 68, 71, 73, 76, 78, 81, 83, 85, 88, 90, 92, 94, 96, 98, 100, 102, 104, 106, 107,
+    109, 111, 112, 113, 115, 116, 117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126,
+    126, 126, 127, 127, 127, 127};
+
+// Sine of a phase in 1/256 turns, scaled to -127..127
+int sine256(uint8_t phase)
 {
-  // ceiling
-  if (gameData.sleighY < 2)
-  {
-    gameData.sleighY = 2;
-    gameData.sleighVelocity = -gameData.sleighVelocity / 3; // Bounce effect
-  }
-  // Ground
-  if (!gameData.sleighCrashed && gameData.sleighY >= PLAYFIELD_HEIGHT - SLEIGH_HITBOX)
-  {
-    gameData.sleighY = PLAYFIELD_HEIGHT - SLEIGH_HITBOX;
-    gameData.sleighVelocity = -gameData.sleighVelocity; // Bounce effect
-    gameData.sleighCrashed = true;
-    gameData.crashingStartTime = millis();
-    return;
-  }
-  // Check if crashed sleigh hit the ground - start explosion animation
-  if (gameData.sleighCrashed && !gameData.sleighExploding && gameData.sleighY >= PLAYFIELD_HEIGHT - SLEIGH_HITBOX)
-  {
-    gameData.sleighExploding = true;
-    gameData.explosionStartTime = millis();
-    gameData.sleighY = PLAYFIELD_HEIGHT - SLEIGH_HITBOX; // Lock at ground
-    gameData.sleighVelocity = 0;
-    return;
+  int i = phase & 63;
+  switch (phase >> 6)
+  {
+  case 0:
+    return SINE_QUARTER[i];
+  case 1:
+    return SINE_QUARTER[64 - i];
+  case 2:
+    return -SINE_QUARTER[i];
+  default:
+    return -SINE_QUARTER[64 - i];
   }
+}
+
+// Where the clock is in a wave of the given period, in 1/256 turns
+uint8_t wavePhase(uint32_t periodMs)
+{
+  return (millis() % periodMs) * 256 / periodMs;
+}
 
-  // Check if explosion animation is complete (1000 milliseconds)
-  if (gameData.sleighExploding && millis() - gameData.explosionStartTime >= 1000)
+// Recolour a panel-order colour for the crash tint: halfway to red. Sky stays sky, since
+// it stands in for transparency in the sprites.
+uint16_t crashTint(uint16_t panelColor)
+{
+  if (panelColor == PANEL_COLOR(SKY_BLUE))
   {
-    gameData.state = STATE_GAME_OVER;
-    gameData.lastStateChange = millis();
-    return;
+    return panelColor;
   }
+  uint16_t color = PANEL_COLOR(panelColor); // PANEL_COLOR swaps both ways
+  int r = ((color >> 11) + 0x1F) / 2;
+  int g = ((color >> 5) & 0x3F) / 2;
+  int b = (color & 0x1F) / 2;
+  return PANEL_COLOR((uint16_t)(r << 11 | g << 5 | b));
+}
 
-  // Trees
-  for (int i = 0; i < TREE_COUNT; i++)
+// Lookup table to expand an indexed sprite through for the current palette effect,
+// or nullptr for its own palette. Valid until the next call.
+const uint16_t *effectPalette(const SpriteImage &image)
+{
+  static uint16_t lut[256];
+  if (paletteEffect == PALETTE_NORMAL || image.format == ATLAS_FORMAT_RGB565)
   {
-    if (gameData.trees[i].active &&
-        gameData.trees[i].pos.x < SLEIGH_START_X + SLEIGH_HITBOX &&
-        gameData.trees[i].pos.x + TREE_WIDTH > SLEIGH_START_X + 2)
-    {
-      if (gameData.sleighY + SLEIGH_HITBOX > PLAYFIELD_HEIGHT - TREE_HEIGHT)
-      {
-        // Collision with tree - set crashed and let sleigh fall
-        gameData.sleighCrashed = true;
-        gameData.crashingStartTime = millis();
-        gameData.sleighY = PLAYFIELD_HEIGHT - TREE_HEIGHT - SLEIGH_HITBOX;
-        gameData.sleighVelocity = -gameData.sleighVelocity / 2; // Bounce effect
-        return;
-      }
-    }
+    return nullptr;
   }
-
-  // Flying obstacles (ducks, foes, gifts)
-  for (int i = 0; i < DUCK_COUNT; i++)
+  for (int i = 0; i < image.colors; i++)
   {
-    if (gameData.flyingObstacles[i].active && !gameData.flyingObstacles[i].falling &&
-        gameData.flyingObstacles[i].pos.x < SLEIGH_START_X + SLEIGH_HITBOX &&
-        gameData.flyingObstacles[i].pos.x + DUCK_HITBOX > SLEIGH_START_X + 2)
-    {
-      if (gameData.sleighY < gameData.flyingObstacles[i].pos.y + DUCK_HEIGHT &&
-          gameData.sleighY + SLEIGH_HEIGHT > gameData.flyingObstacles[i].pos.y)
-      {
-
-        // Collision detected - handle based on obstacle type
-        ObstacleType type = gameData.flyingObstacles[i].type;
-
-        if (type == TYPE_DUCK)
-        {
-          // Duck: set crashed and let sleigh fall
-          gameData.sleighCrashed = true;
-          gameData.crashingStartTime = millis();
-          if (gameData.sleighVelocity < 0)
-          {
-            gameData.sleighVelocity = -gameData.sleighVelocity; // bump downwards
-          }
-          return;
-        }
-        else if (type == TYPE_FOE)
-        {
-          // Foe: check if we're falling (hitting from above) or flapping
-          if (gameData.sleighVelocity > 0)
-          {
-            // Falling/moving down - kill the foe
-            gameData.flyingObstacles[i].falling = true;
-            gameData.flyingObstacles[i].fallVelocity = 2.0;
-            gameData.currentScore += 20;
-            // Give sleigh a bounce
-            gameData.sleighVelocity = -3.0;
-          }
-          else if (!gameData.sleighCrashed)
-          {
-            // Flapping/moving up - lose points and game over
-            gameData.currentScore -= 10;
-            if (gameData.currentScore < 0)
-              gameData.currentScore = 0;
-            gameData.sleighCrashed = true;
-            gameData.crashingStartTime = millis();
-            // Give sleigh a big bounce
-            gameData.sleighVelocity = -6.0;
-            return;
-          }
-        }
-        else if (type == TYPE_GIFT)
-        {
-          // Gift: collect for 10 points
-          gameData.currentScore += 10;
-          // Clear the gift sprite position immediately
-          tft.fillRect(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y,
-                       DUCK_WIDTH, DUCK_HEIGHT, SKY_BLUE);
-          gameData.flyingObstacles[i].active = false;
-          gameData.flyingObstacles[i].spawnTimer = millis() + random(SPAWN_DELAY_MIN, SPAWN_DELAY_MAX);
-        }
-      }
-    }
+    lut[i] = crashTint(image.palette[i]);
   }
+  return lut;
 }
 
-void updateHighScores()
+// Push an image to the panel as one window, clipped to the screen. RGB565 rows stream
+// straight from wherever the pixels live (mapped flash or RAM); indexed rows are
+// expanded through the palette one at a time. trail extends every row with that many
+// sky pixels on the right, erasing in the same window what a sprite moving left uncovered.
+void drawSprite(const SpriteImage &image, int x, int y, int trail = 0)
 {
-  if (!gameData.highScoreUpdated)
+  Rect r = {(int16_t)x, (int16_t)y, (int16_t)(image.width + trail), image.height};
+  if (image.empty() || !r.clip())
+  {
+    return;
+  }
+  int right = x + image.width < r.x + r.w ? x + image.width : r.x + r.w;
+  int spriteWidth = right > r.x ? right - r.x : 0;
+  uint16_t scratch[SCREEN_WIDTH];
+  const uint16_t *palette = effectPalette(image);
+  tft.startWrite();
+  tft.setAddrWindow(r.x, r.y, r.w, r.h);
+  for (int row = r.y; row < r.y + r.h; row++)
   {
-    if (gameData.currentScore > gameData.sessionHighScore[gameData.gameMode])
+    if (spriteWidth > 0)
     {
-      gameData.sessionHighScore[gameData.gameMode] = gameData.currentScore;
+      tft.pushPixels(imageRow(image, row - y, r.x - x, spriteWidth, scratch, palette), spriteWidth);
     }
-    if (gameData.currentScore > gameData.foreverHighScore[gameData.gameMode])
+    if (spriteWidth < r.w)
     {
-      gameData.foreverHighScore[gameData.gameMode] = gameData.currentScore;
-      char key[16];
-      sprintf(key, "highscore%d", gameData.gameMode);
-      preferences.putInt(key, gameData.foreverHighScore[gameData.gameMode]);
+      tft.pushBlock(SKY_BLUE, r.w - spriteWidth);
     }
-    gameData.highScoreUpdated = true;
   }
+  tft.endWrite();
 }
 
-// ============================================================================
-// RENDERING
-// ============================================================================
-
-void drawMenu()
+void drawMenu(const GameData &data)
 {
   tft.setTextColor(WHITE, SKY_BLUE, true);
   tft.setTextSize(2);
   tft.drawString("Appuyez!", 70, 30);
   tft.setTextSize(1);
   tft.drawString("L'aventure du Pere Noel!", 40, 70);
-  if (gameData.gameMode == MODE_SPEED)
+  if (data.gameMode == MODE_SPEED)
   {
     tft.drawString("Mode Rapide", 85, 100);
   }
-  else if (gameData.gameMode == MODE_CHEAT)
+  else if (data.gameMode == MODE_CHEAT)
   {
     tft.drawString("Mode  Cheat", 85, 100);
   }
@@ -1185,207 +1826,852 @@ void drawMenu()
     tft.drawString("Mode Normal", 85, 100);
   }
   int speed = 600;
-  float speed2 = 500;
-  if (gameData.gameMode != MODE_NORMAL)
+  uint8_t sleighPhase = wavePhase(MENU_WAVE_PERIOD);
+  if (data.gameMode != MODE_NORMAL)
   {
     speed = 300;
-    speed2 = 250;
+    sleighPhase = wavePhase(MENU_WAVE_PERIOD / 2);
   }
 
-  if (millis() / speed % 2 == 0)
+  const Animation &duck = animations[CLIP_DUCK];
+  drawSprite(duck.frame(duck.count > 0 ? millis() / speed % duck.count : 0), SCREEN_WIDTH - 40, 30);
+  tft.fillRect(10, 20, SLEIGH_WIDTH, SLEIGH_HEIGHT + 20, SKY_BLUE);
+  if (sine256(sleighPhase + 64) > 0)
   {
-    duckSprite.pushSprite(SCREEN_WIDTH - 40, 30);
+    drawSprite(sprites[SPRITE_SLEIGH1], 10, 30 + sine256(sleighPhase) * 10 / 127);
   }
   else
   {
-    duckSprite2.pushSprite(SCREEN_WIDTH - 40, 30);
+    drawSprite(sprites[SPRITE_SLEIGH0], 10, 30 + sine256(sleighPhase) * 10 / 127);
   }
-  tft.fillRect(10, 20, SLEIGH_WIDTH, SLEIGH_HEIGHT + 20, SKY_BLUE);
-  if (cos(millis() / speed2) > 0)
+  tft.fillRect(SCREEN_WIDTH - 30, 90, SLEIGH_WIDTH, SLEIGH_HEIGHT + 20, SKY_BLUE);
+  if (data.gameMode == MODE_CHEAT)
   {
-    sleighSprite2.pushSprite(10, 30 + sin(millis() / speed2) * 10);
+    uint8_t foePhase = wavePhase(MENU_FOE_WAVE_PERIOD);
+    drawSprite(animations[CLIP_FOE].frame(sine256(foePhase + 64) > 0 ? 1 : 0), SCREEN_WIDTH - 30,
+               100 + sine256(foePhase) * 10 / 127);
   }
-  else
+  tft.drawString("https://github.com/tardyp/ttgo-noel", 10, 122);
+}
+
+#if RENDER_STATS
+// Count one SPI window write of the given area (clipped to the screen)
+void renderStatsAdd(int x, int y, int w, int h)
+{
+  Rect r = {(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h};
+  if (r.clip())
   {
-    sleighSprite.pushSprite(10, 30 + sin(millis() / speed2) * 10);
+    renderStats.windows++;
+    renderStats.bytes += r.area() * 2;
   }
-  tft.fillRect(SCREEN_WIDTH - 30, 90, SLEIGH_WIDTH, SLEIGH_HEIGHT + 20, SKY_BLUE);
-  if (gameData.gameMode == MODE_CHEAT)
+}
+#else
+void renderStatsAdd(int, int, int, int)
+{
+}
+#endif
+
+void renderStatsEndFrame()
+{
+#if RENDER_STATS
+  renderStats.frames++;
+  uint32_t now = millis();
+  if (now - renderStats.lastReport >= RENDER_STATS_INTERVAL)
+  {
+    static const char *names[] = {"direct", "framebuffer", "bands", "queued"};
+    Serial.printf("render[%s]: %.1f windows/frame, %lu bytes/frame, %lu us/frame waiting on SPI\n",
+                  names[renderMode], (float)renderStats.windows / renderStats.frames,
+                  (unsigned long)(renderStats.bytes / renderStats.frames),
+                  (unsigned long)(renderStats.spiWaitMicros / renderStats.frames));
+    renderStats.frames = 0;
+    renderStats.windows = 0;
+    renderStats.bytes = 0;
+    renderStats.spiWaitMicros = 0;
+    renderStats.lastReport = now;
+  }
+#endif
+}
+
+// Sprite for an obstacle: the tree, or a flying obstacle's current clip and frame
+const SpriteImage *obstacleSprite(const EntityStore &entities, int slot)
+{
+  if (entities.type[slot] == TYPE_TREE)
+  {
+    return &sprites[SPRITE_TREE];
+  }
+  return &animations[entities.anim[slot].clip].frame(entities.anim[slot].frame);
+}
+
+// Sprite and screen row for the sleigh this frame, or nullptr when it is hidden by the crash flashing
+const SpriteImage *sleighFrameSprite(const GameData &data, int &y)
+{
+  y = FIXED_TO_INT(data.sleighY);
+  if (data.sleighExploding)
+  {
+    // make sure we are above the ground
+    y = PLAYFIELD_HEIGHT - SLEIGH_HITBOX * 2;
+    // Alternate between explosion frames every 300ms
+    return &sprites[(millis() / 300) % 2 == 0 ? SPRITE_EXPLOSION0 : SPRITE_EXPLOSION1];
+  }
+  if (data.sleighCrashed && millis() / 100 % 2 == 0)
   {
-    if (cos(millis() / 200.0) > 0)
+    // Flashing effect when crashed
+    return nullptr;
+  }
+  // Frame 0 when moving up (negative velocity), Frame 1 when moving down (positive velocity)
+  return &sprites[data.sleighVelocity < 0 ? SPRITE_SLEIGH0 : SPRITE_SLEIGH1];
+}
+
+void fillPixels(uint16_t *pixels, int count, uint16_t color)
+{
+  for (int i = 0; i < count; i++)
+  {
+    pixels[i] = color;
+  }
+}
+
+// Render the score into its arena buffer with the GLCD font's glyphs, as drawString would,
+// but with no TFT_eSprite buffer and no String allocation per frame
+SpriteImage drawScoreSprite(const GameData &data)
+{
+  char text[24];
+  snprintf(text, sizeof(text), "Score: %d", data.currentScore);
+  uint16_t color = PANEL_COLOR(WHITE);
+  fillPixels(scoreBuffer, SCORE_WIDTH * SCORE_HEIGHT, PANEL_COLOR(GROUND_GREEN));
+  for (int i = 0; text[i] != '\0' && (i + 1) * GLYPH_ADVANCE <= SCORE_WIDTH; i++)
+  {
+    const uint8_t *glyph = font + (uint8_t)text[i] * GLYPH_WIDTH;
+    for (int col = 0; col < GLYPH_WIDTH; col++)
     {
-      foeSprite2.pushSprite(SCREEN_WIDTH - 30, 100 + sin(millis() / 200.0) * 10);
+      uint8_t bits = pgm_read_byte(glyph + col); // One column, top row in bit 0
+      for (int row = 0; bits != 0; row++, bits >>= 1)
+      {
+        if (bits & 1)
+        {
+          scoreBuffer[(SCORE_TEXT_Y + row) * SCORE_WIDTH + i * GLYPH_ADVANCE + col] = color;
+        }
+      }
+    }
+  }
+  return rgb565Image(scoreBuffer, SCORE_WIDTH, SCORE_HEIGHT, SCORE_WIDTH);
+}
+
+// Fill one draw slot per entity slot (trees, then flying obstacles) and the sleigh (back-to-front);
+// hidden slots get a nullptr sprite
+void buildDrawList(const GameData &data, DrawItem *items)
+{
+  const EntityStore &entities = data.entities;
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    items[slot] = {entities.isActive(slot) ? obstacleSprite(entities, slot) : nullptr, entities.x[slot], entities.y[slot]};
+  }
+
+  int sleighY;
+  const SpriteImage *sleigh = sleighFrameSprite(data, sleighY);
+  items[SLEIGH_SLOT] = {sleigh, SLEIGH_START_X, (int16_t)sleighY};
+}
+
+// Wait for the DMA transfer in flight, counting the time as SPI wait
+void waitForDma()
+{
+#if RENDER_STATS
+  uint32_t start = micros();
+  tft.dmaWait();
+  renderStats.spiWaitMicros += micros() - start;
+#else
+  tft.dmaWait();
+#endif
+}
+
+#if RENDER_MODE == RENDER_QUEUED
+// Start sending the current staging buffer, composed for r; returns once the previous transfer is done
+void sendStaging(const Rect &r)
+{
+  DisplayQueue &queue = displayQueue;
+  if (!queue.writing)
+  {
+    tft.startWrite();
+    queue.writing = true;
+  }
+  waitForDma();
+  tft.pushImageDMA(r.x, r.y, r.w, r.h, queue.staging[queue.current]);
+  renderStatsAdd(r.x, r.y, r.w, r.h);
+  queue.current ^= 1;
+}
+
+// Compose the pending window and start sending it
+void submitWindow()
+{
+  DisplayQueue &queue = displayQueue;
+  const Rect &r = queue.window;
+  if (r.w == 0)
+  {
+    return;
+  }
+  uint16_t *staging = queue.staging[queue.current];
+  fillPixels(staging, r.area(), PANEL_COLOR(SKY_BLUE));
+  for (int i = 0; i < queue.spriteCount; i++)
+  {
+    const QueuedSprite &sprite = queue.sprites[i];
+    blitImage(sprite.image, sprite.x - r.x, sprite.y, staging, r.w, r.y, r.h, effectPalette(sprite.image));
+  }
+  sendStaging(r);
+  queue.window = {};
+  queue.spriteCount = 0;
+}
+
+// Send what is pending and wait until the panel is free for synchronous drawing
+void finishQueue()
+{
+  submitWindow();
+  if (displayQueue.writing)
+  {
+    waitForDma();
+    tft.endWrite();
+    displayQueue.writing = false;
+  }
+}
+
+// Whether two rects sit side by side with the same extent, so together they make one
+// rectangle without covering each other (a later draw must win where they overlap)
+bool formsRect(const Rect &a, const Rect &b)
+{
+  bool rows = a.y == b.y && a.h == b.h && (a.x + a.w == b.x || b.x + b.w == a.x);
+  bool columns = a.x == b.x && a.w == b.w && (a.y + a.h == b.y || b.y + b.h == a.y);
+  return rows || columns;
+}
+
+// Queue a window that is sky except for an optional sprite, merging it into the pending
+// window when the two form one rectangle
+void queueWindow(Rect r, const SpriteImage *image, int x, int y)
+{
+  DisplayQueue &queue = displayQueue;
+  int trail = image != nullptr ? r.w - image->width : 0;
+  if (!r.clip())
+  {
+    return;
+  }
+  if (r.area() > QUEUE_STAGING_PIXELS)
+  {
+    // Too big to stage: draw it synchronously, after everything queued before it
+    finishQueue();
+#if RENDER_STATS
+    uint32_t start = micros();
+#endif
+    if (image != nullptr)
+    {
+      drawSprite(*image, x, y, trail);
     }
     else
     {
-      foeSprite.pushSprite(SCREEN_WIDTH - 30, 100 + sin(millis() / 200.0) * 10);
+      tft.fillRect(r.x, r.y, r.w, r.h, SKY_BLUE);
     }
+#if RENDER_STATS
+    renderStats.spiWaitMicros += micros() - start; // A blocking push is all SPI wait
+#endif
+    renderStatsAdd(r.x, r.y, r.w, r.h);
+    return;
+  }
+  Rect merged = queue.window.unionWith(r);
+  if (queue.window.w == 0 || !formsRect(queue.window, r) ||
+      merged.area() > QUEUE_STAGING_PIXELS || (image != nullptr && queue.spriteCount == QUEUE_MAX_SPRITES))
+  {
+    submitWindow();
+    merged = r;
+  }
+  queue.window = merged;
+  if (image != nullptr)
+  {
+    queue.sprites[queue.spriteCount++] = {*image, (int16_t)x, (int16_t)y};
   }
-  tft.drawString("https://github.com/tardyp/ttgo-noel", 10, 122);
 }
+#endif
 
-void drawGameplay()
+// Direct path primitives: straight to the panel, or queued (RENDER_QUEUED)
+void directClear(const Rect &r)
 {
+#if RENDER_MODE == RENDER_QUEUED
+  if (renderMode == RENDER_QUEUED)
+  {
+    queueWindow(r, nullptr, 0, 0);
+    return;
+  }
+#endif
+  tft.fillRect(r.x, r.y, r.w, r.h, SKY_BLUE);
+  renderStatsAdd(r.x, r.y, r.w, r.h);
+}
 
-  // Draw obstacles
-  for (int i = 0; i < TREE_COUNT; i++)
+void directSprite(const SpriteImage &image, int x, int y, int trail = 0)
+{
+#if RENDER_MODE == RENDER_QUEUED
+  if (renderMode == RENDER_QUEUED)
   {
-    if (gameData.trees[i].active)
-    {
-      // Clear OLD tree position
-      tft.fillRect(gameData.trees[i].pos.oldX, gameData.trees[i].pos.oldY,
-                   TREE_WIDTH, TREE_HEIGHT, SKY_BLUE);
+    queueWindow({(int16_t)x, (int16_t)y, (int16_t)(image.width + trail), image.height}, &image, x, y);
+    return;
+  }
+#endif
+  drawSprite(image, x, y, trail);
+  renderStatsAdd(x, y, image.width + trail, image.height);
+}
+
+// Clear what was last drawn in a slot, then push the new sprite (if any) and remember its rect.
+// Tracking drawn rects rather than EntityStore::oldX/oldY keeps the panel clean when the renderer
+// skips simulation steps or an object disappears (collected gift).
+void redrawSlot(Rect &drawn, const DrawItem &item)
+{
+  // A same-sized sprite that only moved left (trees, ducks, gifts) or stayed put covers all of
+  // its old rect but the strip it left behind: push it with that strip as one window
+  if (item.sprite != nullptr && drawn.w == item.sprite->width && drawn.h == item.sprite->height &&
+      drawn.y == item.y && drawn.x >= item.x && drawn.x - item.x < drawn.w)
+  {
+    directSprite(*item.sprite, item.x, item.y, drawn.x - item.x);
+    drawn.x = item.x;
+    return;
+  }
+  if (drawn.w > 0)
+  {
+    directClear(drawn);
+  }
+  if (item.sprite == nullptr)
+  {
+    drawn = {};
+    return;
+  }
+  directSprite(*item.sprite, item.x, item.y);
+  drawn = {item.x, item.y, item.sprite->width, item.sprite->height};
+}
 
-      // Draw tree at NEW position
-      if (gameData.trees[i].sprite != nullptr)
+// Direct paths: mark the columns of each strip of rows that has a particle in it now. Called
+// before the particles move (where they were) and after (where they are).
+void markParticleDamage()
+{
+  for (int id = 0; id < POOL_COUNT; id++)
+  {
+    const ParticlePool &pool = particles.pools[id];
+    int end = pool.first + pool.count;
+    for (int i = pool.first; i < end; i++)
+    {
+      int x = particles.x[i] >> PARTICLE_FRAC_BITS;
+      int y = particles.y[i] >> PARTICLE_FRAC_BITS;
+      if ((unsigned)y < PLAYFIELD_HEIGHT)
       {
-        gameData.trees[i].sprite->pushSprite(gameData.trees[i].pos.x, gameData.trees[i].pos.y);
+        particleDamage[y / PARTICLE_STRIP_ROWS][x >> 5] |= 1u << (x & 31);
       }
     }
   }
+}
+
+bool particleDamaged(const uint32_t *columns, int x)
+{
+  return columns[x >> 5] & (1u << (x & 31));
+}
 
-  for (int i = 0; i < DUCK_COUNT; i++)
+// Compose a playfield window from sky, the sprites and the particles
+void composeParticleWindow(uint16_t *pixels, const Rect &r, const DrawItem *items)
+{
+  fillPixels(pixels, r.area(), PANEL_COLOR(SKY_BLUE));
+  for (int i = 0; i < DRAW_SLOTS; i++)
   {
-    if (gameData.flyingObstacles[i].active || gameData.flyingObstacles[i].falling)
+    if (items[i].sprite != nullptr)
     {
-      // Clear OLD position
-      tft.fillRect(gameData.flyingObstacles[i].pos.oldX, gameData.flyingObstacles[i].pos.oldY,
-                   DUCK_WIDTH, DUCK_HEIGHT, SKY_BLUE);
+      blitImage(*items[i].sprite, items[i].x - r.x, items[i].y, pixels, r.w, r.y, r.h,
+                effectPalette(*items[i].sprite));
+    }
+  }
+  rasterizeParticles(pixels, r.y, r.h, r.x, r.w);
+}
 
-      // Draw obstacle at current position based on type
-      ObstacleType type = gameData.flyingObstacles[i].type;
+// Push a composed particle window: through the staging pair, after what is queued
+// (RENDER_QUEUED), or straight to the panel
+void drawParticleWindow(const Rect &r, const DrawItem *items)
+{
+#if RENDER_MODE == RENDER_QUEUED
+  if (renderMode == RENDER_QUEUED)
+  {
+    submitWindow();
+    composeParticleWindow(displayQueue.staging[displayQueue.current], r, items);
+    sendStaging(r);
+    return;
+  }
+#endif
+  composeParticleWindow(particleStaging, r, items);
+  drawSprite(rgb565Image(particleStaging, r.w, r.h, r.w), r.x, r.y);
+  renderStatsAdd(r.x, r.y, r.w, r.h);
+}
 
-      if (type == TYPE_DUCK)
+// Direct paths: redraw where particles were and are, after the sprites. Each strip's marked
+// columns go out as composed windows, split where the gap would cost more than a window setup,
+// instead of a window per particle and another to erase it.
+void drawParticlesDirect(const DrawItem *items)
+{
+  if (particleStaging == nullptr && renderMode != RENDER_QUEUED)
+  {
+    return;
+  }
+  markParticleDamage();
+  for (int strip = 0; strip < PARTICLE_STRIPS; strip++)
+  {
+    uint32_t *columns = particleDamage[strip];
+    int top = strip * PARTICLE_STRIP_ROWS;
+    int height = min(PARTICLE_STRIP_ROWS, PLAYFIELD_HEIGHT - top);
+    int maxGap = DIRTY_MERGE_SLACK / height;
+    int x = 0;
+    while (x < SCREEN_WIDTH)
+    {
+      if (columns[x >> 5] == 0)
       {
-        // Draw duck with animation
-        if (gameData.flyingObstacles[i].flapFrame)
-        {
-          duckSprite2.pushSprite(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y);
-        }
-        else
-        {
-          duckSprite.pushSprite(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y);
-        }
+        x = (x | 31) + 1; // Nothing in the rest of this word
+        continue;
       }
-      else if (type == TYPE_FOE)
+      if (!particleDamaged(columns, x))
       {
-        // Draw foe with animation
-        if (gameData.flyingObstacles[i].flapFrame)
-        {
-          foeSprite2.pushSprite(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y);
-        }
-        else
-        {
-          foeSprite.pushSprite(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y);
-        }
+        x++;
+        continue;
       }
-      else if (type == TYPE_GIFT)
+      int right = x + 1;
+      for (int col = right; col < SCREEN_WIDTH && col - right <= maxGap; col++)
       {
-        // Draw gift (no animation)
-        giftSprite.pushSprite(gameData.flyingObstacles[i].pos.x, gameData.flyingObstacles[i].pos.y);
+        if (particleDamaged(columns, col))
+        {
+          right = col + 1;
+        }
       }
+      drawParticleWindow({(int16_t)x, (int16_t)top, (int16_t)(right - x), (int16_t)height}, items);
+      x = right;
     }
+    memset(columns, 0, sizeof(particleDamage[strip]));
   }
-  // // Clear sleigh area
-  tft.fillRect(SLEIGH_START_X, (int)gameData.sleighOldY - 2,
-               SLEIGH_WIDTH + 2, SLEIGH_HEIGHT + 4, SKY_BLUE);
+}
 
-  // Draw sleigh - alternate between explosion sprites if exploding
-  if (gameData.sleighExploding)
+// Direct path: clear each object's previous rect and push its sprite straight to the panel
+void drawGameplayDirect(const GameData &data, const DrawItem *items)
+{
+  for (int i = 0; i < DRAW_SLOTS; i++)
   {
-    // make sure we are above the ground
-    gameData.sleighY = PLAYFIELD_HEIGHT - SLEIGH_HITBOX * 2;
-    // Alternate between explosion frames every 300ms
-    if ((millis() / 300) % 2 == 0)
+    if (items[i].sprite != nullptr || drawnSlots[i].w > 0)
     {
-      explosionSprite.pushSprite(SLEIGH_START_X, (int)gameData.sleighY);
+      redrawSlot(drawnSlots[i], items[i]);
     }
-    else
+  }
+  drawParticlesDirect(items);
+
+  // Draw ground
+  // tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
+
+  // Draw score
+  directSprite(drawScoreSprite(data), SCORE_X, PLAYFIELD_HEIGHT);
+}
+
+#if RENDER_MODE == RENDER_QUEUED
+// Queued path: the direct path's windows, particles included, composed into the staging pair
+void drawGameplayQueued(const GameData &data, const DrawItem *items)
+{
+  for (int i = 0; i < DRAW_SLOTS; i++)
+  {
+    if (items[i].sprite != nullptr || drawnSlots[i].w > 0)
     {
-      explosionSprite2.pushSprite(SLEIGH_START_X, (int)gameData.sleighY);
+      redrawSlot(drawnSlots[i], items[i]);
     }
   }
-  else
+  drawParticlesDirect(items);
+  directSprite(drawScoreSprite(data), SCORE_X, PLAYFIELD_HEIGHT);
+  submitWindow(); // The last transfer finishes on its own; the next one waits for it
+}
+#endif
+
+// Dirty rects = where objects are now plus where they were last frame (and the score when it changes)
+void computeDirtyRects(const GameData &data, const DrawItem *items)
+{
+  DirtyList currentRects;
+  currentRects.clear();
+  for (int i = 0; i < DRAW_SLOTS; i++)
   {
-    if (gameData.sleighCrashed && !gameData.sleighExploding && millis() / 100 % 2 == 0)
+    if (items[i].sprite != nullptr)
     {
-      // Flashing effect when crashed
-      return;
+      currentRects.add(items[i].x, items[i].y, items[i].sprite->width, items[i].sprite->height);
     }
-    // Normal rendering: choose frame based on velocity direction
-    // Frame 0 when moving up (negative velocity), Frame 1 when moving down (positive velocity)
-    if (gameData.sleighVelocity < 0)
+  }
+
+  dirtyRects = currentRects;
+  for (int i = 0; i < previousRects.count; i++)
+  {
+    const Rect &r = previousRects.rects[i];
+    dirtyRects.add(r.x, r.y, r.w, r.h);
+  }
+  if (data.currentScore != lastFlushedScore)
+  {
+    dirtyRects.add(SCORE_X, PLAYFIELD_HEIGHT, SCORE_WIDTH, SCORE_HEIGHT);
+    lastFlushedScore = data.currentScore;
+  }
+  previousRects = currentRects;
+
+  Rect extent = particleExtent();
+  if (extent.w > 0)
+  {
+    dirtyRects.add(extent.x, extent.y, extent.w, extent.h);
+  }
+  if (particleBounds.w > 0)
+  {
+    dirtyRects.add(particleBounds.x, particleBounds.y, particleBounds.w, particleBounds.h);
+  }
+  particleBounds = extent;
+
+  if (renderFullFlush)
+  {
+    dirtyRects.clear();
+    dirtyRects.add(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    renderFullFlush = false;
+  }
+}
+
+// Framebuffer path: recompose the whole frame in RAM, then push only the dirty
+// rects, merged into as few windows as possible
+void drawGameplayFramebuffer(const GameData &data, const DrawItem *items)
+{
+  fillPixels(frameBuffer, SCREEN_WIDTH * PLAYFIELD_HEIGHT, PANEL_COLOR(SKY_BLUE));
+  fillPixels(frameBuffer + SCREEN_WIDTH * PLAYFIELD_HEIGHT, SCREEN_WIDTH * GROUND_HEIGHT, PANEL_COLOR(GROUND_GREEN));
+  for (int i = 0; i < DRAW_SLOTS; i++)
+  {
+    if (items[i].sprite != nullptr)
     {
-      sleighSprite.pushSprite(SLEIGH_START_X, (int)gameData.sleighY);
+      blitImage(*items[i].sprite, items[i].x, items[i].y, frameBuffer, SCREEN_WIDTH, 0, SCREEN_HEIGHT,
+                effectPalette(*items[i].sprite));
     }
-    else
+  }
+  rasterizeParticles(frameBuffer, 0, PLAYFIELD_HEIGHT);
+  blitImage(drawScoreSprite(data), SCORE_X, PLAYFIELD_HEIGHT, frameBuffer, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+
+  computeDirtyRects(data, items);
+  dirtyRects.merge();
+
+  for (int i = 0; i < dirtyRects.count; i++)
+  {
+    const Rect &r = dirtyRects.rects[i];
+    drawSprite(rgb565Image(frameBuffer + r.y * SCREEN_WIDTH + r.x, r.w, r.h, SCREEN_WIDTH), r.x, r.y);
+    renderStatsAdd(r.x, r.y, r.w, r.h);
+  }
+}
+
+#if RENDER_MODE == RENDER_BANDS
+// Fill one band with the background and copy the rows of every sprite that overlaps it
+void composeBand(uint16_t *band, int bandY, int bandHeight, const DrawItem *items, int count)
+{
+  for (int row = 0; row < bandHeight; row++)
+  {
+    uint16_t *line = band + row * SCREEN_WIDTH;
+    bool sky = bandY + row < PLAYFIELD_HEIGHT;
+    if (row > 0 && sky == (bandY + row - 1 < PLAYFIELD_HEIGHT))
     {
-      sleighSprite2.pushSprite(SLEIGH_START_X, (int)gameData.sleighY);
+      // Same background as the row above
+      memcpy(line, line - SCREEN_WIDTH, SCREEN_WIDTH * sizeof(uint16_t));
+      continue;
+    }
+    uint16_t color = PANEL_COLOR(sky ? SKY_BLUE : GROUND_GREEN);
+    for (int x = 0; x < SCREEN_WIDTH; x++)
+    {
+      line[x] = color;
     }
   }
 
-  // Draw ground
-  // tft.fillRect(0, PLAYFIELD_HEIGHT, SCREEN_WIDTH, GROUND_HEIGHT, GROUND_GREEN);
+  for (int i = 0; i < count; i++)
+  {
+    if (items[i].sprite != nullptr)
+    {
+      blitImage(*items[i].sprite, items[i].x, items[i].y, band, SCREEN_WIDTH, bandY, bandHeight,
+                effectPalette(*items[i].sprite));
+    }
+  }
 
-  // Draw score
-  scoreSprite.fillSprite(GROUND_GREEN);
-  scoreSprite.setTextColor(WHITE, GROUND_GREEN);
-  scoreSprite.setTextSize(1);
-  scoreSprite.drawString("Score: " + String(gameData.currentScore), 0, 2);
-  scoreSprite.pushSprite(5, PLAYFIELD_HEIGHT);
+  rasterizeParticles(band, bandY, min(bandHeight, PLAYFIELD_HEIGHT - bandY));
+}
+
+// Band path: compose each dirty band into one buffer while DMA pushes the previous band
+void drawGameplayBands(const GameData &data, const DrawItem *slots)
+{
+  computeDirtyRects(data, slots);
+
+  DrawItem items[DRAW_SLOTS + 1];
+  memcpy(items, slots, sizeof(DrawItem) * DRAW_SLOTS);
+  SpriteImage score = drawScoreSprite(data);
+  items[DRAW_SLOTS] = {&score, SCORE_X, PLAYFIELD_HEIGHT};
+
+  bool bandDirty[BAND_COUNT] = {};
+  for (int i = 0; i < dirtyRects.count; i++)
+  {
+    const Rect &r = dirtyRects.rects[i];
+    for (int band = r.y / BAND_HEIGHT; band <= (r.y + r.h - 1) / BAND_HEIGHT; band++)
+    {
+      bandDirty[band] = true;
+    }
+  }
+
+  int current = 0;
+  tft.startWrite();
+  for (int band = 0; band < BAND_COUNT; band++)
+  {
+    if (!bandDirty[band])
+    {
+      continue;
+    }
+    int bandY = band * BAND_HEIGHT;
+    int bandHeight = min(BAND_HEIGHT, SCREEN_HEIGHT - bandY);
+    composeBand(bandBuffers[current], bandY, bandHeight, items, DRAW_SLOTS + 1);
+    // Waits for the previous band's transfer, then starts this one and returns
+    waitForDma();
+    tft.pushImageDMA(0, bandY, SCREEN_WIDTH, bandHeight, bandBuffers[current]);
+    renderStatsAdd(0, bandY, SCREEN_WIDTH, bandHeight);
+    current ^= 1;
+  }
+  waitForDma();
+  tft.endWrite();
 }
+#endif
 
-void drawGameOver()
+// Turn simulation events into particles and advance every emitter by the elapsed simulation steps
+void updateEffects(const GameData &data, int steps)
 {
-  if (!gameData.gameOverScreenDrawn)
+  if (data.sleighExploding && !renderedExploding)
+  {
+    emitExplosion(SLEIGH_START_X + SLEIGH_WIDTH / 2, PLAYFIELD_HEIGHT - SLEIGH_HITBOX * 2 + SLEIGH_HEIGHT / 2);
+  }
+  renderedExploding = data.sleighExploding;
+
+  if (data.giftsCollected != renderedGifts)
   {
-    initializeSnow();
-    tft.fillRect(20, 30, 200, 80, TFT_BLACK);
-    tft.drawRect(20, 30, 200, 80, WHITE);
-    tft.setTextColor(TFT_RED, TFT_BLACK);
-    tft.setTextSize(2);
-    tft.drawString("Perdu!!", 80, 38);
-    tft.setTextSize(1);
-    tft.setTextColor(WHITE, TFT_BLACK);
-    tft.drawString("Score: " + String(gameData.currentScore), 75, 60);
-    tft.drawString("Meilleur: " + String(gameData.sessionHighScore[gameData.gameMode]), 55, 75);
-    tft.drawString("Record: " + String(gameData.foreverHighScore[gameData.gameMode]), 65, 88);
-    tft.drawString("Appuyez pour recommencer", 35, 100);
-    gameData.gameOverScreenDrawn = true;
+    emitSparkles(data.lastGiftX + GIFT_WIDTH / 2, data.lastGiftY + GIFT_HEIGHT / 2);
+    renderedGifts = data.giftsCollected;
   }
 
-  updateSnow();
+  for (int i = 0; i < steps; i++)
+  {
+    emitSnow(GAMEPLAY_SNOWFLAKES, particles.pools[POOL_SNOW].count == 0);
+    updateParticles();
+  }
+}
+
+void drawGameplay(const GameData &data, int steps)
+{
+  if (renderMode == RENDER_DIRECT || renderMode == RENDER_QUEUED)
+  {
+    // Where the particles were, to redraw without them once they move
+    markParticleDamage();
+  }
+  updateEffects(data, steps);
+  buildDrawList(data, frameItems);
+
+  switch (renderMode)
+  {
+  case RENDER_FRAMEBUFFER:
+    drawGameplayFramebuffer(data, frameItems);
+    break;
+#if RENDER_MODE == RENDER_BANDS
+  case RENDER_BANDS:
+    drawGameplayBands(data, frameItems);
+    break;
+#elif RENDER_MODE == RENDER_QUEUED
+  case RENDER_QUEUED:
+    drawGameplayQueued(data, frameItems);
+    break;
+#endif
+  default:
+    drawGameplayDirect(data, frameItems);
+    break;
+  }
+  renderStatsEndFrame();
+}
+
+void drawGameOver(const GameData &data)
+{
+  emitSnowPile();
+  buildSnowMap(20, 30, 200, 80);
+  tft.fillRect(20, 30, 200, 80, TFT_BLACK);
+  tft.drawRect(20, 30, 200, 80, WHITE);
+  tft.setTextColor(TFT_RED, TFT_BLACK);
+  tft.setTextSize(2);
+  tft.drawString("Perdu!!", 80, 38);
+  tft.setTextSize(1);
+  tft.setTextColor(WHITE, TFT_BLACK);
+  tft.drawString("Score: " + String(data.currentScore), 75, 60);
+  tft.drawString("Meilleur: " + String(data.sessionHighScore[data.gameMode]), 55, 75);
+  tft.drawString("Record: " + String(data.foreverHighScore[data.gameMode]), 65, 88);
+  tft.drawString("Appuyez pour recommencer", 35, 100);
 }
 
 // ============================================================================
 // MAIN LOOP
 // ============================================================================
 
-void loop()
+// Advance the game by one fixed step of SIM_STEP_MS ending at stepEnd (micros()). Never touches the display.
+// Same phases as stepGame, called one by one so the profiler can time them.
+void simulationStep(uint32_t stepEnd)
+{
+  beginStep(gameData);
+#if PROFILER
+  pollProfiler();
+#endif
+
+  PROFILED(PHASE_INPUT, applyInput(gameData, readInput(stepEnd)));
+
+  if (gameData.state == STATE_PLAYING)
+  {
+    PROFILED(PHASE_PHYSICS, updatePhysics(gameData));
+    PROFILED(PHASE_OBSTACLES, updateObstacles(gameData));
+    PROFILED(PHASE_ANIMATION, updateFlyingAnimation(gameData));
+    PROFILED(PHASE_COLLISIONS, checkCollisions(gameData));
+    PROFILED(PHASE_SCORE, updateScore(gameData));
+  }
+
+  // Same step as the transition, so the game over panel shows the new records
+  if (gameData.state == STATE_GAME_OVER && updateHighScores(gameData))
+  {
+    saveHighScore(gameData);
+  }
+}
+
+int lerp(int from, int to, int alpha)
 {
-  handleInput();
+  return from + (((to - from) * alpha) >> 8);
+}
 
-  switch (gameData.state)
+// Copy of a state with every moving object placed alpha/256 of the way from its
+// position at the start of the step to its position at the end
+GameData interpolateState(const GameData &data, int alpha)
+{
+  GameData view = data;
+  view.sleighY = data.sleighOldY + (fixed_t)(((int64_t)(data.sleighY - data.sleighOldY) * alpha) >> 8);
+  EntityStore &entities = view.entities;
+  for (int slot = 0; slot < ENTITY_COUNT; slot++)
+  {
+    entities.x[slot] = lerp(entities.oldX[slot], entities.x[slot], alpha);
+    entities.y[slot] = lerp(entities.oldY[slot], entities.y[slot], alpha);
+  }
+  return view;
+}
+
+// Draw one frame of the given state. Only the renderer touches the display.
+void renderFrame(const GameData &data)
+{
+  // Cosmetic effects advance with simulation time, not with the render rate
+  int steps = (data.simTime - renderedSimTime) / SIM_STEP_MS;
+  if (steps > MAX_CATCHUP_STEPS)
+  {
+    steps = MAX_CATCHUP_STEPS;
+  }
+  renderedSimTime = data.simTime;
+#if RENDER_MODE == RENDER_QUEUED
+  // Gameplay keeps the queue going from frame to frame; anything else draws synchronously
+  // and needs the panel, so drain it when the screen changes or leaves gameplay
+  if (renderMode == RENDER_QUEUED && (data.state != STATE_PLAYING || data.state != renderedState))
+  {
+    finishQueue();
+  }
+#endif
+  paletteEffect = data.state == STATE_PLAYING && (data.sleighCrashed || data.sleighExploding) ? PALETTE_CRASH : PALETTE_NORMAL;
+
+  if (data.state != renderedState)
+  {
+    if (data.state == STATE_GAME_OVER)
+    {
+      drawGameOver(data);
+    }
+    else
+    {
+      clearScreen();
+    }
+    renderedState = data.state;
+  }
+
+  switch (data.state)
   {
   case STATE_MENU:
-    drawMenu();
-    delay(30);
+    drawMenu(data);
     break;
 
   case STATE_PLAYING:
-    updatePhysics();
-    updateObstacles();
-    updateFlyingAnimation();
-    checkCollisions();
-    updateScore();
-    drawGameplay();
-    delay(30);
+    PROFILED(PHASE_DRAW, drawGameplay(data, steps));
     break;
 
   case STATE_GAME_OVER:
-    updateHighScores();
-    drawGameOver();
-    delay(30);
+    for (int i = 0; i < steps; i++)
+    {
+      updateSnow();
+    }
     break;
   }
 }
+
+// Ticks to the next frame. 1000 / TARGET_FPS ms would round 16.7 ms down to 16 at 60 FPS, which
+// is 62.5 FPS; carrying the rest of FRAME_US over to the next frame mixes 16 and 17 ms waits.
+TickType_t nextFrameTicks(uint32_t &frameRemainderUs)
+{
+  frameRemainderUs += FRAME_US;
+  TickType_t ticks = frameRemainderUs / (portTICK_PERIOD_MS * 1000);
+  frameRemainderUs -= ticks * portTICK_PERIOD_MS * 1000;
+  return ticks;
+}
+
+#if DUAL_CORE
+void simulationTask(void *)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    uint32_t now = micros();
+    simulationStep(now);
+    Snapshot &slot = snapshots.writeSlot();
+    slot.game = gameData;
+    slot.stepMicros = now;
+    snapshots.publish();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SIM_STEP_MS));
+  }
+}
+
+void renderTask(void *)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  uint32_t frameRemainderUs = 0;
+  for (;;)
+  {
+#if PROFILER
+    pollRenderProfiler();
+#endif
+    // Keeps the previous snapshot when no new step was published
+    snapshots.acquire();
+    const Snapshot &snapshot = snapshots.readSlot();
+    uint32_t sinceStep = micros() - snapshot.stepMicros;
+    int alpha = sinceStep >= SIM_STEP_US ? 256 : sinceStep * 256 / SIM_STEP_US;
+    renderFrame(interpolateState(snapshot.game, alpha));
+    vTaskDelayUntil(&lastWake, nextFrameTicks(frameRemainderUs));
+  }
+}
+#endif
+
+void loop()
+{
+#if DUAL_CORE
+  // Hand the game over to the pinned tasks and retire the Arduino loop task
+  xTaskCreatePinnedToCore(renderTask, "render", 8192, nullptr, 1, nullptr, RENDER_CORE);
+  xTaskCreatePinnedToCore(simulationTask, "simulation", 4096, nullptr, 2, nullptr, SIM_CORE);
+  vTaskDelete(nullptr);
+#else
+  static TickType_t lastWake = xTaskGetTickCount();
+  static uint32_t frameRemainderUs = 0;
+
+  // Run as many fixed steps as real time demands, however long the last frame took
+  uint32_t now = micros();
+  simAccumulator += now - lastTickMicros;
+  lastTickMicros = now;
+  if (simAccumulator > MAX_CATCHUP_STEPS * SIM_STEP_US)
+  {
+    simAccumulator = MAX_CATCHUP_STEPS * SIM_STEP_US;
+  }
+  while (simAccumulator >= SIM_STEP_US)
+  {
+    simAccumulator -= SIM_STEP_US;
+    simulationStep(now - simAccumulator);
+  }
+
+  renderFrame(interpolateState(gameData, simAccumulator * 256 / SIM_STEP_US));
+  vTaskDelayUntil(&lastWake, nextFrameTicks(frameRemainderUs));
+#endif
+}